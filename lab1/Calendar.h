@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+// proleptic Gregorian calendar arithmetic, no timezone database involved
+
+inline bool isLeap(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+inline int daysInMonth(int year, int month) {
+    static const int DAYS[]{ 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return month == 2 && isLeap(year) ? 29 : DAYS[month - 1];
+}
+
+// days since 1970-01-01 of date
+inline std::int64_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    std::int64_t era{ (year >= 0 ? year : year - 399) / 400 };
+    std::int64_t yoe{ year - era * 400 };
+    std::int64_t doy{ (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1 };
+    std::int64_t doe{ yoe * 365 + yoe / 4 - yoe / 100 + doy };
+    return era * 146097 + doe - 719468;
+}
+
+// date of days since 1970-01-01
+inline void civilFromDays(std::int64_t days, int* year, int* month, int* day) {
+    days += 719468;
+    std::int64_t era{ (days >= 0 ? days : days - 146096) / 146097 };
+    std::int64_t doe{ days - era * 146097 };
+    std::int64_t yoe{ (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365 };
+    std::int64_t doy{ doe - (365 * yoe + yoe / 4 - yoe / 100) };
+    std::int64_t mp{ (5 * doy + 2) / 153 };
+    *day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    *month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    *year = static_cast<int>(yoe + era * 400 + (*month <= 2));
+}
+
+// weekday of days since 1970-01-01, Sunday is 0
+inline int weekdayFromDays(std::int64_t days) {
+    return static_cast<int>(((days + 4) % 7 + 7) % 7);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+// time source of the schedule
+// the simulated clock moves only when set, so a schedule can be replayed faster than real time
+class Clock {
+  public:
+    using TimePoint = std::chrono::system_clock::time_point;
+
+    virtual ~Clock() = default;
+    virtual TimePoint now() const = 0;
+
+    static const Clock& system();   // wall clock
+};
+
+class SystemClock : public Clock {
+  public:
+    TimePoint now() const override { return std::chrono::system_clock::now(); }
+};
+
+class SimulatedClock : public Clock {
+  public:
+    explicit SimulatedClock(TimePoint start) : m_now(start.time_since_epoch().count()) {}
+
+    TimePoint now() const override {
+        return TimePoint(TimePoint::duration(m_now.load(std::memory_order_relaxed)));
+    }
+    void set(TimePoint time) { m_now.store(time.time_since_epoch().count(), std::memory_order_relaxed); }
+
+  private:
+    std::atomic<TimePoint::rep> m_now;
+};
+
+inline const Clock& Clock::system() {
+    static SystemClock clock;
+    return clock;
+}
@@ -0,0 +1,164 @@
+#include <ctime>
+
+#include "Calendar.h"
+#include "ConfigParser.h"
+
+namespace {
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// skip whitespace, returns number of skipped chars
+std::size_t skipSpaces(std::string_view& str) {
+    std::size_t cnt{};
+    while (cnt < str.size() && isSpace(str[cnt]))
+        ++cnt;
+    str.remove_prefix(cnt);
+    return cnt;
+}
+
+// read number of minDigits..maxDigits digits
+bool readNumber(std::string_view& str, std::size_t minDigits, std::size_t maxDigits, int* value) {
+    std::size_t cnt{};
+    int result{};
+    while (cnt < str.size() && cnt < maxDigits && isDigit(str[cnt]))
+        result = result * 10 + (str[cnt++] - '0');
+    if (cnt < minDigits)
+        return false;
+    str.remove_prefix(cnt);
+    *value = result;
+    return true;
+}
+
+bool readChar(std::string_view& str, char c) {
+    if (str.empty() || str.front() != c)
+        return false;
+    str.remove_prefix(1);
+    return true;
+}
+
+}
+
+ConfigParser::ConfigParser() {
+    updateOffset();
+}
+
+void ConfigParser::updateOffset() {
+    std::time_t now{ std::time(nullptr) };
+    std::tm tm{};
+    localtime_r(&now, &tm);
+    m_utcOffset = tm.tm_gmtoff;
+}
+
+ConfigParser::Status ConfigParser::parse(std::string_view line, Line* out) const {
+    static constexpr std::string_view COMMAND{ "add_event" };
+    static constexpr std::string_view CRON_COMMAND{ "add_cron" };
+
+    skipSpaces(line);
+    if (line.substr(0, CRON_COMMAND.size()) == CRON_COMMAND)
+        return parseCron(line.substr(CRON_COMMAND.size()), out);
+    if (line.substr(0, COMMAND.size()) != COMMAND)
+        return Status::SYNTAX;
+    out->rule = {};
+    line.remove_prefix(COMMAND.size());
+    if (!skipSpaces(line))
+        return Status::SYNTAX;
+
+    // date and time tokens
+    std::size_t dateLen{};
+    while (dateLen < line.size() && !isSpace(line[dateLen]))
+        ++dateLen;
+    std::string_view date{ line.substr(0, dateLen) };
+    line.remove_prefix(dateLen);
+    if (date.empty() || !skipSpaces(line))
+        return Status::SYNTAX;
+
+    std::size_t timeLen{};
+    while (timeLen < line.size() && !isSpace(line[timeLen]))
+        ++timeLen;
+    std::string_view time{ line.substr(0, timeLen) };
+    line.remove_prefix(timeLen);
+    if (time.empty() || !skipSpaces(line))
+        return Status::SYNTAX;
+
+    // optional repeat flag followed by whitespace, a lone flag is the text itself
+    std::string_view rest{ line };
+    out->repeat = std::chrono::seconds(0);
+    if (line.size() >= 2 && line[0] == '-' && (line.size() == 2 || isSpace(line[2]))) {
+        switch (line[1]) {
+        case 'm': out->repeat = std::chrono::seconds(60); break;
+        case 'h': out->repeat = std::chrono::seconds(60 * 60); break;
+        case 'd': out->repeat = std::chrono::seconds(24 * 60 * 60); break;
+        case 'w': out->repeat = std::chrono::seconds(7 * 24 * 60 * 60); break;
+        }
+        if (out->repeat != std::chrono::seconds(0)) {
+            line.remove_prefix(2);
+            skipSpaces(line);
+        }
+    }
+
+    // text up to trailing whitespace
+    while (!line.empty() && isSpace(line.back()))
+        line.remove_suffix(1);
+    if (line.empty()) {
+        line = rest;
+        out->repeat = std::chrono::seconds(0);
+        while (!line.empty() && isSpace(line.back()))
+            line.remove_suffix(1);
+    }
+    if (line.empty())
+        return Status::SYNTAX;
+    out->text = line;
+
+    int day{}, month{}, year{}, hour{}, minute{}, second{};
+    if (!readNumber(date, 1, 2, &day) || !readChar(date, '/')
+        || !readNumber(date, 1, 2, &month) || !readChar(date, '/')
+        || !readNumber(date, 4, 4, &year) || !date.empty())
+        return Status::TIME;
+    if (!readNumber(time, 1, 2, &hour) || !readChar(time, ':')
+        || !readNumber(time, 1, 2, &minute) || !readChar(time, ':')
+        || !readNumber(time, 1, 2, &second) || !time.empty())
+        return Status::TIME;
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)
+        || hour > 23 || minute > 59 || second > 60)
+        return Status::TIME;
+
+    long long seconds{ daysFromCivil(year, month, day) * 24ll * 60 * 60
+        + hour * 60 * 60 + minute * 60 + second - m_utcOffset };
+    out->time = std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+    return Status::OK;
+}
+
+ConfigParser::Status ConfigParser::parseCron(std::string_view line, Line* out) const {
+    if (!skipSpaces(line))
+        return Status::SYNTAX;
+
+    // five rule fields, each followed by whitespace
+    std::string_view fields[5];
+    for (auto& field : fields) {
+        std::size_t len{};
+        while (len < line.size() && !isSpace(line[len]))
+            ++len;
+        field = line.substr(0, len);
+        line.remove_prefix(len);
+        if (field.empty() || !skipSpaces(line))
+            return Status::SYNTAX;
+    }
+
+    while (!line.empty() && isSpace(line.back()))
+        line.remove_suffix(1);
+    if (line.empty())
+        return Status::SYNTAX;
+    out->text = line;
+
+    if (!CronRule::compile(fields, &out->rule))
+        return Status::TIME;
+    out->time = {};
+    out->repeat = std::chrono::seconds(0);
+    return Status::OK;
+}
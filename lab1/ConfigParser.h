@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <string_view>
+
+#include "CronRule.h"
+
+// single-pass parser of config lines in the form
+// "add_event DD/MM/YYYY HH:MM:SS [-m|-h|-d|-w] text"
+// or "add_cron MIN HOUR DAY MONTH WEEKDAY text" (see CronRule)
+// dates are decoded arithmetically with a cached UTC offset
+// instead of consulting the timezone for every line
+class ConfigParser {
+  public:
+    enum class Status {
+        OK,     // line parsed
+        SYNTAX, // line doesn't match the grammar
+        TIME    // line matches, but the date or time is invalid
+    };
+
+    struct Line {
+        std::chrono::system_clock::time_point time{};   // event time, not set for rules
+        std::chrono::seconds repeat{};  // repetition time, zero if not specified
+        CronRule rule{};    // recurrence rule, empty for add_event lines
+        std::string_view text{};    // text to remind, points into the parsed line
+    };
+
+    ConfigParser();
+
+    void updateOffset();    // cache UTC offset of local time for now
+    long utcOffset() const { return m_utcOffset; }  // seconds east of UTC
+    Status parse(std::string_view line, Line* out) const;
+
+  private:
+    long m_utcOffset{}; // seconds east of UTC
+
+    Status parseCron(std::string_view line, Line* out) const;  // line after "add_cron"
+};
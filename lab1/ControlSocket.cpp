@@ -0,0 +1,299 @@
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ControlSocket.h"
+#include "Logger.h"
+
+ControlSocket::~ControlSocket() {
+    close();
+}
+
+bool ControlSocket::open(const std::string& path, int epollFd, Handler handler) {
+    LOG(LOG_INFO, "Opening control socket %s", path.c_str());
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        LOG(LOG_ERR, "Control socket path is too long");
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    if ((m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+        LOG(LOG_ERR, "socket(2) call error: %s", strerror(errno));
+        return false;
+    }
+
+    // the running daemon was checked by pid, so the file is left from a crash
+    unlink(path.c_str());
+    // daemon umask is zero, only the owner may change the schedule
+    mode_t mask{ umask(S_IRWXG | S_IRWXO) };
+    int res{ bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) };
+    umask(mask);
+    if (res == -1) {
+        LOG(LOG_ERR, "bind(2) call error: %s", strerror(errno));
+        return false;
+    }
+    m_path = path;
+
+    if (listen(m_listenFd, SOMAXCONN) == -1) {
+        LOG(LOG_ERR, "listen(2) call error: %s", strerror(errno));
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = m_listenFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, m_listenFd, &ev) == -1) {
+        LOG(LOG_ERR, "epoll_ctl(2) call error: %s", strerror(errno));
+        return false;
+    }
+    m_epollFd = epollFd;
+    m_handler = std::move(handler);
+    return true;
+}
+
+void ControlSocket::close(bool keepFile) {
+    while (!m_connections.empty())
+        drop(m_connections.begin()->first);
+
+    if (m_listenFd != -1) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+    }
+    if (!m_path.empty()) {
+        if (!keepFile)
+            unlink(m_path.c_str());
+        m_path.clear();
+    }
+}
+
+bool ControlSocket::request(const std::string& path, std::string_view command, std::string* reply, int* fd) {
+    *fd = -1;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int sock{ socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+    if (sock == -1) {
+        LOG(LOG_ERR, "socket(2) call error: %s", strerror(errno));
+        return false;
+    }
+    timeval timeout{ REQUEST_TIMEOUT, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string line{ std::string(command) + '\n' };
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1
+        || send(sock, line.data(), line.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(line.size())) {
+        LOG(LOG_INFO, "Control socket %s request error: %s", path.c_str(), strerror(errno));
+        ::close(sock);
+        return false;
+    }
+
+    // descriptors arrive with the first bytes of the reply
+    reply->clear();
+    while (reply->find('\n') == std::string::npos) {
+        char buf[256];
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        iovec iov{ buf, sizeof(buf) };
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t len{ recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) };
+        if (len <= 0) {
+            LOG(LOG_WARNING, "Control socket %s reply error: %s", path.c_str(), len ? strerror(errno) : "closed");
+            break;
+        }
+        for (cmsghdr* cmsg{ CMSG_FIRSTHDR(&msg) }; cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && *fd == -1)
+                std::memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+        reply->append(buf, len);
+    }
+    ::close(sock);
+
+    std::size_t end{ reply->find('\n') };
+    if (end == std::string::npos) {
+        if (*fd != -1)
+            ::close(*fd);
+        *fd = -1;
+        return false;
+    }
+    reply->resize(end);
+    return true;
+}
+
+bool ControlSocket::owns(int fd) const {
+    return fd == m_listenFd || m_connections.count(fd);
+}
+
+void ControlSocket::handle(int fd, std::uint32_t events) {
+    if (fd == m_listenFd) {
+        accept();
+        return;
+    }
+
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end())
+        return;
+    Connection& conn{ it->second };
+
+    if (events & EPOLLIN) {
+        char buf[64 * 1024];
+        ssize_t len{ read(fd, buf, sizeof(buf)) };
+        if (len > 0) {
+            conn.input.append(buf, len);
+        }
+        else if (len == 0) {
+            // a last line without newline is still a command
+            if (!conn.input.empty() && conn.input.back() != '\n')
+                conn.input += '\n';
+            conn.isClosing = true;
+        }
+        else if (errno != EAGAIN && errno != EINTR) {
+            LOG(LOG_WARNING, "Control connection read error: %s", strerror(errno));
+            drop(fd);
+            return;
+        }
+    }
+    else if (events & (EPOLLERR | EPOLLHUP) && !(events & EPOLLOUT)) {
+        drop(fd);
+        return;
+    }
+
+    serve(fd, conn);
+}
+
+void ControlSocket::accept() {
+    int fd;
+    while ((fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        if (m_connections.size() >= MAX_CONNECTIONS) {
+            LOG(LOG_WARNING, "Too many control connections, rejecting");
+            ::close(fd);
+            continue;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            LOG(LOG_ERR, "epoll_ctl(2) call error: %s", strerror(errno));
+            ::close(fd);
+            continue;
+        }
+        m_connections[fd].events = EPOLLIN;
+        LOG(LOG_DEBUG, "Control connection %i accepted", fd);
+    }
+    if (errno != EAGAIN && errno != EINTR)
+        LOG(LOG_WARNING, "accept4(2) call error: %s", strerror(errno));
+}
+
+void ControlSocket::serve(int fd, Connection& conn) {
+    for (;;) {
+        // replies are bounded, the rest of input waits until the client reads them
+        std::size_t pos{};
+        std::size_t end;
+        while (conn.output.size() < MAX_OUTPUT && (end = conn.input.find('\n', pos)) != std::string::npos) {
+            std::string_view line{ conn.input.data() + pos, end - pos };
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            int fd{ -1 };
+            m_handler(line, &conn.output, &fd);
+            if (fd != -1)
+                conn.fds.push_back(fd);
+            pos = end + 1;
+        }
+        conn.input.erase(0, pos);
+
+        while (!conn.output.empty()) {
+            ssize_t len{ conn.fds.empty() ? send(fd, conn.output.data(), conn.output.size(), MSG_NOSIGNAL)
+                : sendFds(fd, conn) };
+            if (len == -1) {
+                if (errno == EAGAIN || errno == EINTR)
+                    break;
+                LOG(LOG_WARNING, "Control connection write error: %s", strerror(errno));
+                drop(fd);
+                return;
+            }
+            conn.output.erase(0, len);
+        }
+
+        if (!conn.output.empty() || conn.input.find('\n') == std::string::npos)
+            break;
+    }
+
+    if (conn.input.size() > MAX_LINE) {
+        LOG(LOG_WARNING, "Control command is too long, closing connection");
+        drop(fd);
+        return;
+    }
+    if (conn.isClosing && conn.output.empty()) {
+        drop(fd);
+        return;
+    }
+
+    std::uint32_t events{};
+    if (!conn.isClosing && conn.output.size() < MAX_OUTPUT)
+        events |= EPOLLIN;
+    if (!conn.output.empty())
+        events |= EPOLLOUT;
+    if (events != conn.events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+            LOG(LOG_ERR, "epoll_ctl(2) call error: %s", strerror(errno));
+            drop(fd);
+            return;
+        }
+        conn.events = events;
+    }
+}
+
+ssize_t ControlSocket::sendFds(int fd, Connection& conn) {
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * conn.fds.size()));
+    iovec iov{ &conn.output[0], conn.output.size() };
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    cmsghdr* cmsg{ CMSG_FIRSTHDR(&msg) };
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * conn.fds.size());
+    std::memcpy(CMSG_DATA(cmsg), conn.fds.data(), sizeof(int) * conn.fds.size());
+
+    // the client has its own copies once the bytes carrying them are sent
+    ssize_t len{ sendmsg(fd, &msg, MSG_NOSIGNAL) };
+    if (len > 0) {
+        for (int passed : conn.fds)
+            ::close(passed);
+        conn.fds.clear();
+    }
+    return len;
+}
+
+void ControlSocket::drop(int fd) {
+    LOG(LOG_DEBUG, "Control connection %i closed", fd);
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end())
+        return;
+    for (int passed : it->second.fds)
+        ::close(passed);
+    m_connections.erase(it);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+// unix domain socket accepting line commands from local tools
+// connections are non-blocking and served from the daemon epoll set,
+// every complete input line is passed to the handler, which appends its reply
+// and may set fd to a descriptor passed to the client with the reply (SCM_RIGHTS)
+class ControlSocket {
+  public:
+    using Handler = std::function<void(std::string_view line, std::string* reply, int* fd)>;
+
+    ~ControlSocket();
+
+    // bind socket at path and register it in epoll set
+    bool open(const std::string& path, int epollFd, Handler handler);
+    // close connections and remove socket file, unless a successor has bound it already
+    void close(bool keepFile = false);
+
+    // client side: send command and read one reply line with a passed fd, -1 if none was passed
+    static bool request(const std::string& path, std::string_view command, std::string* reply, int* fd);
+
+    bool owns(int fd) const;    // fd is the listening socket or one of connections
+    void handle(int fd, std::uint32_t events);  // process epoll events of owned fd
+
+  private:
+    static constexpr std::size_t MAX_LINE{ 64 * 1024 };     // longer lines drop connection
+    static constexpr std::size_t MAX_OUTPUT{ 1024 * 1024 }; // stop reading until client takes replies
+    static constexpr std::size_t MAX_CONNECTIONS{ 64 };
+    static constexpr int REQUEST_TIMEOUT{ 5 };  // s to wait for the daemon in request()
+
+    struct Connection {
+        std::string input{};    // received bytes not yet processed
+        std::string output{};   // replies not yet sent
+        std::vector<int> fds{}; // descriptors sent with the next output bytes
+        std::uint32_t events{}; // registered epoll events
+        bool isClosing{};   // client finished sending
+    };
+
+    std::string m_path{};
+    int m_epollFd{ -1 };
+    int m_listenFd{ -1 };
+    Handler m_handler{};
+    std::unordered_map<int, Connection> m_connections{};
+
+    void accept();  // accept pending connections
+    void serve(int fd, Connection& conn);   // process lines, send replies, update epoll events
+    ssize_t sendFds(int fd, Connection& conn);  // send output with pending descriptors
+    void drop(int fd);
+};
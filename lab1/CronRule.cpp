@@ -0,0 +1,166 @@
+#include <algorithm>
+
+#include "Calendar.h"
+#include "CronRule.h"
+
+constexpr std::uint8_t CronRule::ANY_DAY;
+constexpr std::uint8_t CronRule::ANY_WEEKDAY;
+
+namespace {
+
+// upper bound of search iterations, every one moves to the next candidate month, day or hour
+constexpr int MAX_STEPS{ 4096 };
+
+bool readNumber(std::string_view& str, int* value) {
+    std::size_t cnt{};
+    int result{};
+    while (cnt < str.size() && cnt < 3 && str[cnt] >= '0' && str[cnt] <= '9')
+        result = result * 10 + (str[cnt++] - '0');
+    if (!cnt)
+        return false;
+    str.remove_prefix(cnt);
+    *value = result;
+    return true;
+}
+
+// bits of values lo..hi allowed by field
+bool compileField(std::string_view field, int lo, int hi, std::uint64_t* mask) {
+    *mask = 0;
+    while (!field.empty()) {
+        std::string_view item{ field.substr(0, field.find(',')) };
+        field.remove_prefix(std::min(item.size() + 1, field.size()));
+        if (item.empty())
+            return false;
+
+        int first{ lo }, last{ hi }, step{ 1 };
+        if (item.front() == '*') {
+            item.remove_prefix(1);
+        }
+        else {
+            if (!readNumber(item, &first))
+                return false;
+            last = first;
+            if (!item.empty() && item.front() == '-') {
+                item.remove_prefix(1);
+                if (!readNumber(item, &last))
+                    return false;
+            }
+        }
+        if (!item.empty() && item.front() == '/') {
+            item.remove_prefix(1);
+            if (!readNumber(item, &step) || !step)
+                return false;
+        }
+        if (!item.empty() || first < lo || last > hi || first > last)
+            return false;
+
+        for (int value{ first }; value <= last; value += step)
+            *mask |= 1ull << value;
+    }
+    return *mask != 0;
+}
+
+// lowest set bit at or above pos, -1 if there is none
+int scan(std::uint64_t mask, int pos) {
+    mask &= pos < 64 ? ~((1ull << pos) - 1) : 0;
+    return mask ? __builtin_ctzll(mask) : -1;
+}
+
+}
+
+bool CronRule::compile(const std::string_view (&fields)[5], CronRule* rule) {
+    std::uint64_t minutes{}, hours{}, days{}, months{}, weekdays{};
+    if (!compileField(fields[0], 0, 59, &minutes) || !compileField(fields[1], 0, 23, &hours)
+        || !compileField(fields[2], 1, 31, &days) || !compileField(fields[3], 1, 12, &months)
+        || !compileField(fields[4], 0, 7, &weekdays))
+        return false;
+
+    rule->minutes = minutes;
+    rule->hours = static_cast<std::uint32_t>(hours);
+    rule->days = static_cast<std::uint32_t>(days);
+    rule->months = static_cast<std::uint16_t>(months);
+    // Sunday is both 0 and 7
+    rule->weekdays = static_cast<std::uint8_t>((weekdays | weekdays >> 7) & 0x7f);
+    rule->flags = (fields[2].front() == '*' ? ANY_DAY : 0) | (fields[4].front() == '*' ? ANY_WEEKDAY : 0);
+    return true;
+}
+
+std::uint32_t CronRule::dayMask(int year, int month) const {
+    int dim{ daysInMonth(year, month) };
+    std::uint32_t valid{ static_cast<std::uint32_t>(((1ull << (dim + 1)) - 1) & ~1ull) };
+
+    // rotate weekdays so bit k is the weekday of day k + 1, then repeat it over the month
+    int first{ weekdayFromDays(daysFromCivil(year, month, 1)) };
+    std::uint64_t week{ ((weekdays >> first) | (weekdays << (7 - first))) & 0x7full };
+    std::uint64_t byWeekday{ week | week << 7 | week << 14 | week << 21 | week << 28 };
+    std::uint32_t weekdayDays{ static_cast<std::uint32_t>(byWeekday << 1) };
+
+    std::uint32_t matched{ flags & (ANY_DAY | ANY_WEEKDAY) ? days & weekdayDays : days | weekdayDays };
+    return matched & valid;
+}
+
+bool CronRule::next(std::chrono::system_clock::time_point after, long utcOffset,
+                    std::chrono::system_clock::time_point* time) const {
+    if (empty())
+        return false;
+
+    // first whole local minute after the given time
+    std::int64_t local{ std::chrono::duration_cast<std::chrono::seconds>(after.time_since_epoch()).count() + utcOffset };
+    std::int64_t minute{ (local >= 0 ? local / 60 : (local - 59) / 60) + 1 };
+    std::int64_t day{ minute >= 0 ? minute / 1440 : (minute - 1439) / 1440 };
+    int hh{ static_cast<int>((minute - day * 1440) / 60) };
+    int mm{ static_cast<int>((minute - day * 1440) % 60) };
+    int year, month, dd;
+    civilFromDays(day, &year, &month, &dd);
+
+    for (int step{}; step < MAX_STEPS; ++step) {
+        int m{ scan(months, month) };
+        if (m == -1) {
+            ++year;
+            m = scan(months, 1);
+        }
+        if (m != month) {
+            month = m;
+            dd = 1;
+            hh = mm = 0;
+        }
+
+        int d{ scan(dayMask(year, month), dd) };
+        if (d == -1) {
+            if (++month > 12) {
+                ++year;
+                month = 1;
+            }
+            dd = 1;
+            hh = mm = 0;
+            continue;
+        }
+        if (d != dd) {
+            dd = d;
+            hh = mm = 0;
+        }
+
+        int h{ scan(hours, hh) };
+        if (h == -1) {
+            ++dd;
+            hh = mm = 0;
+            continue;
+        }
+        if (h != hh) {
+            hh = h;
+            mm = 0;
+        }
+
+        int mi{ scan(minutes, mm) };
+        if (mi == -1) {
+            ++hh;
+            mm = 0;
+            continue;
+        }
+
+        std::int64_t seconds{ (daysFromCivil(year, month, dd) * 1440 + hh * 60 + mi) * 60 - utcOffset };
+        *time = std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+        return true;
+    }
+    return false;
+}
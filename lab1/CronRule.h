@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+// cron-like recurrence "MIN HOUR DAY MONTH WEEKDAY" compiled into bitmasks,
+// fields are lists of "*", "N" or "N-M" items with optional "/STEP",
+// weekdays are 0-7 with Sunday as 0 and 7
+// next occurrence is found with bit scans over month, day, hour and minute masks
+struct CronRule {
+    std::uint64_t minutes{};    // bit per minute 0-59, no bits for empty rule
+    std::uint32_t hours{};  // bit per hour 0-23
+    std::uint32_t days{};   // bit per day of month 1-31
+    std::uint16_t months{}; // bit per month 1-12
+    std::uint8_t weekdays{};    // bit per weekday 0-6
+    std::uint8_t flags{};   // ANY_DAY and ANY_WEEKDAY
+
+    // "*" fields, as in cron a day matches both day and weekday fields
+    // unless both are restricted, then it matches either of them
+    static constexpr std::uint8_t ANY_DAY{ 1 };
+    static constexpr std::uint8_t ANY_WEEKDAY{ 2 };
+
+    // compile five fields, false if any of them is invalid
+    static bool compile(const std::string_view (&fields)[5], CronRule* rule);
+
+    bool empty() const { return !minutes; }
+
+    // first matching minute strictly after time, in local time of utcOffset (seconds east of UTC)
+    // false if the rule matches no date in the next years (like "30 of February")
+    bool next(std::chrono::system_clock::time_point after, long utcOffset,
+              std::chrono::system_clock::time_point* time) const;
+
+  private:
+    std::uint32_t dayMask(int year, int month) const;   // bit per matching day of month
+};
+static_assert(sizeof(CronRule) == 24, "rules are stored in events and snapshot records");
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <spawn.h>
+#include <string_view>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "Dispatcher.h"
+#include "Logger.h"
+#include "Metrics.h"
+
+extern char** environ;
+
+constexpr std::chrono::milliseconds Dispatcher::NO_BATCHING;
+
+Dispatcher::~Dispatcher() {
+    stop();
+}
+
+bool Dispatcher::start(const Settings& settings) {
+    m_settings = settings;
+    m_isStopped = false;
+
+    if (!m_settings.sinkPath.empty()) {
+        // opened non-blocking so a fifo without reader fails instead of hanging, writes block
+        m_sinkFd = open(m_settings.sinkPath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_NONBLOCK | O_CLOEXEC, 0644);
+        if (m_sinkFd == -1 || fcntl(m_sinkFd, F_SETFL, O_APPEND) == -1) {
+            LOG(LOG_ERR, "open(2) call error for notification sink %s: %s", m_settings.sinkPath.c_str(), strerror(errno));
+            return false;
+        }
+    }
+
+    LOG(LOG_INFO, "Starting %zu dispatcher threads, queue capacity %zu, batch window %li ms",
+        m_settings.threads, m_settings.capacity, static_cast<long>(m_settings.batchWindow.count()));
+    for (std::size_t i{}; i < m_settings.threads; ++i)
+        m_threads.emplace_back(&Dispatcher::loop, this);
+    return true;
+}
+
+void Dispatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopped = true;
+    }
+    m_cv.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+    m_threads.clear();
+
+    if (m_sinkFd != -1) {
+        close(m_sinkFd);
+        m_sinkFd = -1;
+    }
+}
+
+bool Dispatcher::submit(std::string text) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!push(std::move(text)))
+            return false;
+    }
+    ++m_submitted;
+    m_cv.notify_one();
+    return true;
+}
+
+std::size_t Dispatcher::submit(std::vector<std::string> texts) {
+    std::size_t accepted{};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& text : texts)
+            accepted += push(std::move(text));
+    }
+    m_submitted += accepted;
+    if (accepted)
+        m_cv.notify_one();
+    return accepted;
+}
+
+Dispatcher::Stats Dispatcher::stats() const {
+    Stats stats;
+    stats.submitted = m_submitted;
+    stats.dropped = m_dropped;
+    stats.delivered = m_delivered;
+    stats.merged = m_merged;
+    stats.spawned = m_spawned;
+    stats.failed = m_failed;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats.maxDepth = m_maxDepth;
+    return stats;
+}
+
+bool Dispatcher::push(std::string&& text) {
+    if (m_queue.size() >= m_settings.capacity) {
+        std::uint64_t dropped{ ++m_dropped };
+        // report on powers of two to keep overload from flooding the log
+        if (!(dropped & (dropped - 1)))
+            LOG(LOG_WARNING, "Dispatch queue is full, %lu notifications dropped so far", dropped);
+        return false;
+    }
+    if (m_queue.empty())
+        m_firstQueued = std::chrono::steady_clock::now();
+    m_queue.push_back(std::move(text));
+    m_maxDepth = std::max(m_maxDepth, m_queue.size());
+    return true;
+}
+
+void Dispatcher::loop() {
+    bool isBatching{ m_settings.batchWindow >= std::chrono::milliseconds(0) };
+    for (;;) {
+        std::vector<std::string> texts;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_isStopped || !m_queue.empty(); });
+            if (m_queue.empty())
+                return;
+
+            if (isBatching) {
+                // another thread may take the batch while this one waits
+                m_cv.wait_until(lock, m_firstQueued + m_settings.batchWindow, [this] { return m_isStopped; });
+                if (m_queue.empty())
+                    continue;
+                texts.assign(std::make_move_iterator(m_queue.begin()), std::make_move_iterator(m_queue.end()));
+                m_queue.clear();
+            }
+            else {
+                texts.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+        deliver(texts.size() == 1 ? texts.front() : coalesce(texts));
+    }
+}
+
+std::string Dispatcher::coalesce(std::vector<std::string>& texts) {
+    // identical texts become one line with their count, first occurrences keep their order
+    std::unordered_map<std::string_view, std::size_t> index;
+    std::vector<std::pair<std::string_view, std::size_t>> lines;
+    for (const auto& text : texts) {
+        auto it = index.emplace(text, lines.size());
+        if (it.second)
+            lines.push_back({ text, 0 });
+        ++lines[it.first->second].second;
+    }
+    m_merged += texts.size() - lines.size();
+
+    std::string result;
+    for (auto& line : lines) {
+        if (!result.empty())
+            result += '\n';
+        result += line.first;
+        if (line.second > 1)
+            result += " (x" + std::to_string(line.second) + ")";
+    }
+    return result;
+}
+
+void Dispatcher::deliver(const std::string& text) {
+    ++m_delivered;
+    if (m_sinkFd != -1)
+        write(text);
+    else
+        notify(text);
+}
+
+void Dispatcher::write(const std::string& text) {
+    // one write keeps concurrent batches from interleaving
+    std::string record{ text + '\n' };
+    ssize_t written{ ::write(m_sinkFd, record.data(), record.size()) };
+    if (written < 0 || static_cast<std::size_t>(written) != record.size()) {
+        ++m_failed;
+        LOG(LOG_ERR, "write(2) call error for notification sink: %s", written < 0 ? strerror(errno) : "short write");
+    }
+}
+
+void Dispatcher::notify(const std::string& text) {
+    // empty command discards notifications, used by the benchmark
+    if (m_settings.command.empty())
+        return;
+
+    std::vector<std::string> args{ m_settings.command };
+    for (auto& arg : args)
+        for (std::size_t pos{}; (pos = arg.find(TEXT_PLACEHOLDER, pos)) != std::string::npos; pos += text.size())
+            arg.replace(pos, std::strlen(TEXT_PLACEHOLDER), text);
+
+    std::vector<char*> argv;
+    for (auto& arg : args)
+        argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    // daemon threads block SIGHUP and SIGTERM for signalfd, notifier shouldn't
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid;
+    int err{ posix_spawnp(&pid, argv[0], nullptr, &attr, argv.data(), environ) };
+    posix_spawnattr_destroy(&attr);
+    if (err) {
+        ++m_failed;
+        LOG(LOG_ERR, "posix_spawnp(3) call error for %s: %s", argv[0], strerror(err));
+        return;
+    }
+    ++m_spawned;
+
+    int status{};
+    while (waitpid(pid, &status, 0) == -1 && errno == EINTR);
+    Metrics::getInstance().dispatch.record(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        ++m_failed;
+        LOG(LOG_WARNING, "Notifier %s (pid: %i) failed with status %i", argv[0], pid, status);
+    }
+}
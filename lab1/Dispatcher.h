@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// pool of threads delivering notifications for fired events
+// the scheduling loop only enqueues texts into a bounded queue,
+// notifications that don't fit into the queue are dropped and counted
+// with batching, texts queued within a window are delivered as one notification
+class Dispatcher {
+  public:
+    // placeholder replaced with event text in notifier arguments
+    static constexpr const char* TEXT_PLACEHOLDER{ "%t" };
+    // batch window that disables batching
+    static constexpr std::chrono::milliseconds NO_BATCHING{ -1 };
+
+    struct Settings {
+        // notifier argv, TEXT_PLACEHOLDER is replaced, empty command delivers nothing
+        std::vector<std::string> command{};
+        std::string sinkPath{}; // file or fifo written instead of launching command
+        std::size_t threads{ 1 };
+        std::size_t capacity{ 1 };  // max queued texts
+        // time to gather texts after the first one is queued, zero takes only already queued texts
+        std::chrono::milliseconds batchWindow{ NO_BATCHING };
+    };
+
+    struct Stats {
+        std::uint64_t submitted{};  // texts accepted into queue
+        std::uint64_t dropped{};    // texts rejected because queue was full
+        std::uint64_t delivered{};  // notifications delivered, one per batch
+        std::uint64_t merged{};     // duplicate texts merged into batches
+        std::uint64_t spawned{};    // notifier processes launched
+        std::uint64_t failed{};     // notifier launch, exit or sink write failures
+        std::size_t maxDepth{};     // queue high-water mark
+    };
+
+    ~Dispatcher();
+
+    bool start(const Settings& settings);   // open sink and start threads
+    void stop();    // deliver queued notifications and join threads
+
+    bool submit(std::string text);  // enqueue notification, false if dropped
+    std::size_t submit(std::vector<std::string> texts); // enqueue under one lock, returns accepted count
+    Stats stats() const;
+
+  private:
+    Settings m_settings{};
+    int m_sinkFd{ -1 };
+
+    mutable std::mutex m_mutex{};
+    std::condition_variable m_cv{};
+    std::deque<std::string> m_queue{};  // pending notification texts
+    std::chrono::steady_clock::time_point m_firstQueued{};  // when queue became non-empty
+    bool m_isStopped{};
+    std::vector<std::thread> m_threads{};
+
+    std::atomic<std::uint64_t> m_submitted{};
+    std::atomic<std::uint64_t> m_dropped{};
+    std::atomic<std::uint64_t> m_delivered{};
+    std::atomic<std::uint64_t> m_merged{};
+    std::atomic<std::uint64_t> m_spawned{};
+    std::atomic<std::uint64_t> m_failed{};
+    std::size_t m_maxDepth{};   // guarded by m_mutex
+
+    bool push(std::string&& text);  // caller holds m_mutex
+    void loop();    // dispatcher thread body
+    std::string coalesce(std::vector<std::string>& texts);  // merge batch into one text
+    void deliver(const std::string& text);  // write to sink or launch notifier
+    void write(const std::string& text);    // write to sink with one call
+    void notify(const std::string& text);   // launch notifier and wait for it
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "CronRule.h"
+#include "StringPool.h"
+
+// reminder event, a plain record stored by value in schedulers
+struct Event {
+    std::chrono::system_clock::time_point time{};   // event time
+    std::chrono::seconds repeat{};  // repetition time (minute/hour/day/week)
+    std::uint64_t key{};    // key of config line the event came from
+    StringPool::Handle text{};  // text to remind, interned in the pool of the owning shard
+    CronRule rule{};    // recurrence rule, empty for fixed repetition time
+};
+static_assert(std::is_trivially_copyable<Event>::value, "events are copied as plain records");
+
+// occurrences of an event due at now, O(1) for any gap
+// for repeating events time + repeat * count is the first occurrence after now,
+// occurrences of rules aren't counted, a due rule event is one occurrence
+inline std::int64_t dueCount(const Event& event, std::chrono::system_clock::time_point now) {
+    if (now < event.time)
+        return 0;
+    if (event.repeat == std::chrono::seconds(0))
+        return 1;
+    return (now - event.time) / event.repeat + 1;
+}
+
+// event with its text before interning, text points into a buffer of the caller
+struct TextEvent {
+    Event event{};
+    std::string_view text{};
+};
@@ -0,0 +1,120 @@
+#include "EventQueue.h"
+
+EventQueue::Id EventQueue::push(Event event) {
+    Id id{};
+    if (m_free.empty()) {
+        id = m_slots.size();
+        m_slots.emplace_back();
+    }
+    else {
+        id = m_free.back();
+        m_free.pop_back();
+    }
+
+    Slot& slot = m_slots[id];
+    slot.used = true;
+    slot.pos = m_heap.size();
+    m_heap.push_back({ event.time, id });
+    slot.event = std::move(event);
+
+    siftUp(slot.pos);
+    return id;
+}
+
+bool EventQueue::remove(Id id) {
+    if (id >= m_slots.size() || !m_slots[id].used)
+        return false;
+
+    std::size_t pos{ m_slots[id].pos };
+    m_slots[id].used = false;
+    m_slots[id].event = {};
+    m_free.push_back(id);
+
+    Node last{ m_heap.back() };
+    m_heap.pop_back();
+    if (pos == m_heap.size())
+        return true;
+
+    place(pos, last);
+    siftUp(pos);
+    siftDown(m_slots[last.id].pos);
+    return true;
+}
+
+void EventQueue::reschedule(Id id, TimePoint time) {
+    Slot& slot = m_slots[id];
+    bool later{ slot.event.time < time };
+    slot.event.time = time;
+    m_heap[slot.pos].time = time;
+
+    if (later)
+        siftDown(slot.pos);
+    else
+        siftUp(slot.pos);
+}
+
+bool EventQueue::poll(TimePoint now, Id* id) {
+    if (m_heap.empty() || now < m_heap.front().time)
+        return false;
+    *id = m_heap.front().id;
+    return true;
+}
+
+bool EventQueue::next(TimePoint* time) const {
+    if (m_heap.empty())
+        return false;
+    *time = m_heap.front().time;
+    return true;
+}
+
+Event& EventQueue::get(Id id) {
+    return m_slots[id].event;
+}
+
+const Event& EventQueue::get(Id id) const {
+    return m_slots[id].event;
+}
+
+std::size_t EventQueue::size() const {
+    return m_heap.size();
+}
+
+void EventQueue::clear() {
+    m_heap.clear();
+    m_slots.clear();
+    m_free.clear();
+}
+
+void EventQueue::place(std::size_t pos, const Node& node) {
+    m_heap[pos] = node;
+    m_slots[node.id].pos = pos;
+}
+
+void EventQueue::siftUp(std::size_t pos) {
+    Node node{ m_heap[pos] };
+    while (pos > 0) {
+        std::size_t parent{ (pos - 1) / 2 };
+        if (!(node.time < m_heap[parent].time))
+            break;
+        place(pos, m_heap[parent]);
+        pos = parent;
+    }
+    place(pos, node);
+}
+
+void EventQueue::siftDown(std::size_t pos) {
+    Node node{ m_heap[pos] };
+    std::size_t size{ m_heap.size() };
+    for (;;) {
+        std::size_t child{ 2 * pos + 1 };
+        if (child >= size)
+            break;
+        if (child + 1 < size && m_heap[child + 1].time < m_heap[child].time)
+            ++child;
+        if (!(m_heap[child].time < node.time))
+            break;
+        place(pos, m_heap[child]);
+        pos = child;
+    }
+    place(pos, node);
+}
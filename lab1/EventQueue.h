@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Scheduler.h"
+
+// indexed binary min-heap of events keyed on event time
+// ids stay valid until the event is removed, so events can be
+// rescheduled or removed in O(log n) without searching for them
+class EventQueue : public Scheduler {
+  public:
+    Id push(Event event) override;  // O(log n)
+    bool remove(Id id) override;    // O(log n)
+    void reschedule(Id id, TimePoint time) override;   // O(log n)
+
+    bool poll(TimePoint now, Id* id) override;  // O(1)
+    bool next(TimePoint* time) const override;  // O(1)
+
+    Event& get(Id id) override;
+    const Event& get(Id id) const override;
+
+    std::size_t size() const override;
+    void clear() override;
+
+  private:
+    // heap node keeps its own copy of the key to avoid indirection on compare
+    struct Node {
+        TimePoint time{};
+        Id id{};
+    };
+
+    struct Slot {
+        Event event{};
+        std::size_t pos{}; // position of event node in heap
+        bool used{};
+    };
+
+    std::vector<Node> m_heap{};   // binary heap ordered by time
+    std::vector<Slot> m_slots{};  // event storage indexed by id
+    std::vector<Id> m_free{};     // ids of removed events for reuse
+
+    void place(std::size_t pos, const Node& node);  // put node to heap position
+    void siftUp(std::size_t pos);
+    void siftDown(std::size_t pos);
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// FNV-1a hash of bytes
+inline std::uint64_t hashBytes(std::string_view bytes, std::uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Logger.h"
+
+std::atomic<int> Logger::s_level{ LOG_INFO };
+
+Logger& Logger::getInstance() {
+    static Logger instance;
+    return instance;
+}
+
+void Logger::setLevel(int level) {
+    s_level.store(level, std::memory_order_relaxed);
+}
+
+int Logger::getLevel() {
+    return s_level.load(std::memory_order_relaxed);
+}
+
+bool Logger::start(const std::string& filePath) {
+    if (!filePath.empty()) {
+        m_fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0640);
+        if (m_fd == -1) {
+            syslog(LOG_ERR, "open(2) call error for log file: %s", strerror(errno));
+            return false;
+        }
+    }
+
+    m_isStopped = false;
+    m_thread = std::thread(&Logger::loop, this);
+    m_isRunning.store(true, std::memory_order_release);
+    return true;
+}
+
+void Logger::stop() {
+    if (!m_thread.joinable())
+        return;
+
+    m_isRunning.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopped = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+
+    drain();
+    if (m_fd != -1) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void Logger::log(int level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    if (!m_isRunning.load(std::memory_order_acquire)) {
+        vsyslog(level, format, args);
+        va_end(args);
+        return;
+    }
+
+    Ring* ring{ localRing() };
+    std::size_t head{ ring->head.load(std::memory_order_relaxed) };
+    if (head - ring->tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        va_end(args);
+        return;
+    }
+
+    Record& record = ring->records[head % RING_SIZE];
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    record.time = ts.tv_sec * 1000000000ll + ts.tv_nsec;
+    record.level = level;
+    vsnprintf(record.text, TEXT_SIZE, format, args);
+    va_end(args);
+
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+Logger::Ring* Logger::localRing() {
+    thread_local Ring* ring{};
+    if (!ring) {
+        auto owned = std::make_unique<Ring>();
+        ring = owned.get();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rings.push_back(std::move(owned));
+    }
+    return ring;
+}
+
+void Logger::loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_isStopped) {
+        m_cv.wait_for(lock, DRAIN_PERIOD);
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+void Logger::drain() {
+    std::vector<Record> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& ring : m_rings) {
+            std::size_t tail{ ring->tail.load(std::memory_order_relaxed) };
+            std::size_t head{ ring->head.load(std::memory_order_acquire) };
+            for (; tail != head; ++tail)
+                batch.push_back(ring->records[tail % RING_SIZE]);
+            ring->tail.store(tail, std::memory_order_release);
+        }
+    }
+
+    // rings are per thread, merge them back into time order
+    std::stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) {
+        return a.time < b.time;
+    });
+
+    std::uint64_t dropped{ m_dropped.exchange(0, std::memory_order_relaxed) };
+    if (m_fd == -1) {
+        for (const Record& record : batch)
+            syslog(record.level, "%s", record.text);
+        if (dropped)
+            syslog(LOG_WARNING, "%lu log records dropped", dropped);
+        return;
+    }
+
+    static const char* LEVELS[]{ "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug" };
+    std::string buf;
+    char prefix[64];
+    for (const Record& record : batch) {
+        std::time_t tt = record.time / 1000000000;
+        std::tm tm;
+        localtime_r(&tt, &tm);
+        std::size_t len{ std::strftime(prefix, sizeof(prefix), "%F %T", &tm) };
+        std::snprintf(prefix + len, sizeof(prefix) - len, ".%03lld %s: ",
+                      static_cast<long long>(record.time / 1000000 % 1000), LEVELS[record.level & 7]);
+        buf += prefix;
+        buf += record.text;
+        buf += '\n';
+    }
+    if (dropped)
+        buf += std::to_string(dropped) + " log records dropped\n";
+
+    if (!buf.empty() && ::write(m_fd, buf.data(), buf.size()) == -1)
+        syslog(LOG_ERR, "write(2) call error for log file: %s", strerror(errno));
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <syslog.h>
+#include <thread>
+#include <vector>
+
+// log through the asynchronous logger, arguments aren't evaluated for filtered levels
+#define LOG(level, ...)                                     \
+    do {                                                    \
+        if (Logger::isEnabled(level))                       \
+            Logger::getInstance().log(level, __VA_ARGS__);  \
+    } while (0)
+
+// singleton asynchronous logger
+// callers format records into their own lock-free single-producer ring,
+// background thread drains all rings to syslog or a file in batches
+// until started (and after stop) records go to syslog synchronously
+class Logger {
+    static constexpr std::size_t RING_SIZE{ 1024 }; // records per thread
+    static constexpr std::size_t TEXT_SIZE{ 240 };  // max record length
+    static constexpr std::chrono::milliseconds DRAIN_PERIOD{ 100 };
+
+    struct Record {
+        std::int64_t time{};    // realtime, ns
+        int level{};
+        char text[TEXT_SIZE]{};
+    };
+
+    struct Ring {
+        alignas(64) std::atomic<std::size_t> head{};    // written by owner thread
+        alignas(64) std::atomic<std::size_t> tail{};    // written by drain thread
+        alignas(64) Record records[RING_SIZE];
+    };
+
+    static std::atomic<int> s_level;    // max enabled level
+
+    std::atomic<bool> m_isRunning{};
+    int m_fd{ -1 }; // log file, -1 for syslog
+
+    std::mutex m_mutex{};   // guards rings list and stop flag
+    std::condition_variable m_cv{};
+    bool m_isStopped{};
+    std::vector<std::unique_ptr<Ring>> m_rings{};
+    std::thread m_thread{};
+
+    std::atomic<std::uint64_t> m_dropped{}; // records lost on full rings
+
+    Logger() {}
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+  public:
+    static Logger& getInstance();
+
+    static bool isEnabled(int level) {
+        return level <= s_level.load(std::memory_order_relaxed);
+    }
+    static void setLevel(int level);
+    static int getLevel();
+
+    // start drain thread, writes to file at filePath or to syslog if it is empty
+    bool start(const std::string& filePath);
+    void stop();    // drain remaining records and join drain thread
+
+    void log(int level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+  private:
+    Ring* localRing();  // ring of calling thread
+    void loop();    // drain thread body
+    void drain();   // write out all pending records
+};
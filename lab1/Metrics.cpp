@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <utility>
+
+#include "Metrics.h"
+
+void Histogram::record(std::uint64_t value) {
+    std::size_t bucket{ value ? std::size_t(64 - __builtin_clzll(value)) : 0 };
+    m_buckets[std::min(bucket, BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    std::uint64_t max{ m_max.load(std::memory_order_relaxed) };
+    while (max < value && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+}
+
+Histogram::Summary Histogram::summary() const {
+    std::uint64_t counts[BUCKETS];
+    Summary summary;
+    for (std::size_t i{}; i < BUCKETS; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        summary.count += counts[i];
+    }
+    summary.sum = m_sum.load(std::memory_order_relaxed);
+    summary.max = m_max.load(std::memory_order_relaxed);
+
+    // buckets are read one by one, so their total is the count of this snapshot
+    std::uint64_t* percentiles[]{ &summary.p50, &summary.p90, &summary.p99 };
+    const std::uint64_t ranks[]{ 50, 90, 99 };
+    for (std::size_t p{}; p < 3; ++p) {
+        std::uint64_t rank{ (summary.count * ranks[p] + 99) / 100 };
+        std::uint64_t seen{};
+        for (std::size_t i{}; i < BUCKETS && summary.count; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                *percentiles[p] = std::min((std::uint64_t(1) << i) - 1, summary.max);
+                break;
+            }
+        }
+    }
+    return summary;
+}
+
+Metrics& Metrics::getInstance() {
+    static Metrics instance;
+    return instance;
+}
+
+void Metrics::report(std::string* out) const {
+    const std::pair<const char*, const Histogram*> histograms[]{
+        { "lateness_us", &lateness },
+        { "dispatch_us", &dispatch },
+        { "tick_events", &tickEvents },
+        { "tick_us", &tickTime },
+        { "config_load_us", &configLoad }
+    };
+
+    for (auto& histogram : histograms) {
+        Histogram::Summary summary{ histogram.second->summary() };
+        *out += std::string(histogram.first)
+            + " count=" + std::to_string(summary.count)
+            + " mean=" + std::to_string(summary.count ? summary.sum / summary.count : 0)
+            + " p50=" + std::to_string(summary.p50)
+            + " p90=" + std::to_string(summary.p90)
+            + " p99=" + std::to_string(summary.p99)
+            + " max=" + std::to_string(summary.max) + '\n';
+    }
+}
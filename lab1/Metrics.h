@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// lock-free histogram with power-of-two buckets
+// bucket i counts values in [2^(i-1), 2^i), bucket 0 counts zeros,
+// writers only do relaxed atomic adds, readers get an approximate snapshot
+class Histogram {
+  public:
+    static constexpr std::size_t BUCKETS{ 64 };
+
+    struct Summary {
+        std::uint64_t count{};
+        std::uint64_t sum{};
+        std::uint64_t max{};
+        std::uint64_t p50{};    // percentiles are upper bounds of their buckets
+        std::uint64_t p90{};
+        std::uint64_t p99{};
+    };
+
+    void record(std::uint64_t value);
+    Summary summary() const;
+
+  private:
+    std::atomic<std::uint64_t> m_buckets[BUCKETS]{};
+    std::atomic<std::uint64_t> m_sum{};
+    std::atomic<std::uint64_t> m_max{};
+};
+
+// singleton set of daemon metrics, updated from scheduling and dispatch threads
+class Metrics {
+    // singleton
+    Metrics() {}
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+  public:
+    Histogram lateness{};   // us between scheduled and actual fire time
+    Histogram dispatch{};   // us to launch notifier and wait for it
+    Histogram tickEvents{}; // events fired per shard wakeup
+    Histogram tickTime{};   // us spent firing events per shard wakeup
+    Histogram configLoad{}; // us per config load
+
+    static Metrics& getInstance();
+
+    void report(std::string* out) const;    // append "<name> count=.. ..." line per histogram
+};
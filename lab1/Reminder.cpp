@@ -1,258 +1,810 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <csignal>
 #include <dirent.h>
 #include <fcntl.h>
 #include <fstream>
-#include <iomanip>
-#include <sstream>
+#include <iterator>
 #include <syslog.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
 #include <sys/stat.h>
 #include <thread>
 #include <unistd.h>
 
+#include "Hash.h"
+#include "Logger.h"
+#include "Metrics.h"
 #include "Reminder.h"
+#include "Snapshot.h"
 
 Reminder& Reminder::getInstance() {
     static Reminder instance;
     return instance;
 }
 
-void Reminder::init(std::string configFile) {
+void Reminder::init(const Options& options) {
     openlog("Reminder", LOG_NDELAY | LOG_PID, LOG_USER);
-    syslog(LOG_INFO, "Logger successfully opened");
-    syslog(LOG_INFO, "Daemon initialization");
+    LOG(LOG_INFO, "Logger successfully opened");
+    LOG(LOG_INFO, "Daemon initialization");
 
-    syslog(LOG_INFO, "Getting config absolute path");
+    LOG(LOG_INFO, "Getting config absolute path");
     char buf[PATH_MAX];
     getcwd(buf, sizeof(buf));
-    m_configFilePath = buf;
-    m_configFilePath += "/" + configFile;
+    m_configFilePath = options.configPath[0] == '/' ? options.configPath : buf + ("/" + options.configPath);
+    struct stat st;
+    m_isDirectory = stat(m_configFilePath.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    if (m_isDirectory) {
+        while (m_configFilePath.size() > 1 && m_configFilePath.back() == '/')
+            m_configFilePath.pop_back();
+        LOG(LOG_INFO, "Config path is a directory, every file in it is a config");
+    }
+    else {
+        m_configFileName = m_configFilePath.substr(m_configFilePath.rfind('/') + 1);
+    }
+    m_loadThreads = std::max<std::size_t>(options.loadThreads, 1);
+    if (!options.logPath.empty())
+        m_logFilePath = options.logPath[0] == '/' ? options.logPath : buf + ("/" + options.logPath);
+    m_pidFilePath = options.pidPath;
+    m_controlFilePath = options.controlPath;
+    m_snapshotFilePath = options.snapshotPath;
+
+    m_simulateSpan = options.simulate;
+    if (m_simulateSpan.count()) {
+        LOG(LOG_INFO, "Simulating %li s of schedule", static_cast<long>(m_simulateSpan.count()));
+        m_simClock = std::make_unique<SimulatedClock>(std::chrono::system_clock::now());
+        m_clock = m_simClock.get();
+    }
 
-    checkPid();
-    toDaemon();
-    writePid();
+    LOG(LOG_INFO, "Creating %zu shards with %s scheduler", options.shards, options.scheduler.c_str());
+    for (std::size_t i{}; i < options.shards; ++i) {
+        Scheduler* events{ Scheduler::create(options.scheduler) };
+        if (!events) {
+            LOG(LOG_ERR, "Unknown scheduler type: %s", options.scheduler.c_str());
+            exit(EXIT_FAILURE);
+        }
+        // simulated shards only count fired events
+        m_shards.push_back(std::make_unique<Shard>(i, events, m_simClock ? nullptr : &m_dispatcher,
+                                                   options.missed, m_clock));
+    }
 
-    syslog(LOG_INFO, "Seting signal handler");
-    std::signal(SIGHUP, signalHandler);
-    std::signal(SIGTERM, signalHandler);
+    if (!m_pidFilePath.empty())
+        checkPid();
+    if (options.daemonize)
+        toDaemon();
+    if (!m_pidFilePath.empty())
+        writePid();
+
+    // a simulation doesn't wait for anything, signals keep their default actions
+    if (!m_simClock)
+        setupEvents();
+
+    // threads inherit the signal mask blocked for signalfd
+    LOG(LOG_INFO, "Starting asynchronous logger");
+    m_logLevel = options.logLevel;
+    Logger::setLevel(m_logLevel);
+    if (!Logger::getInstance().start(m_logFilePath)) {
+        LOG(LOG_ERR, "Logger start error");
+        exit(EXIT_FAILURE);
+    }
+    // nothing is launched in simulation, shards are ticked by simulate()
+    if (!m_simClock) {
+        Dispatcher::Settings dispatch;
+        dispatch.command = options.notifier;
+        dispatch.sinkPath = options.sinkPath;
+        dispatch.threads = options.dispatchThreads;
+        dispatch.capacity = options.dispatchQueue;
+        dispatch.batchWindow = options.batchWindow;
+        if (!m_dispatcher.start(dispatch))
+            exit(EXIT_FAILURE);
+        for (auto& shard : m_shards)
+            if (!shard->start())
+                exit(EXIT_FAILURE);
+    }
 
-    loadConfig();
-    syslog(LOG_INFO, "Daemon successfully initialized");
+    LOG(LOG_INFO, "Checking schedule snapshot");
+    // in directory mode restored lines are matched with files by key, so only changed lines are parsed
+    Snapshot::ConfigInfo info{};
+    bool hasInfo{ m_isDirectory || Snapshot::configInfo(m_configFilePath, &info) };
+    // texts point into the mapped snapshot, so events are interned right away
+    auto restore = [this](std::uint64_t key, TextEvent* event) {
+      if (key & CONTROL_KEY_BIT)
+        m_controlKey = std::max(m_controlKey, key + 1);
+      else if (m_isDirectory)
+        m_restoredKeys.insert(key);
+      else
+        m_configKeys[m_configFileName].insert(key);
+      if (event)
+        shardOf(key).add(*event);
+    };
+    bool isRestored{};
+    if (m_handoffFd != -1) {
+      isRestored = hasInfo && Snapshot::read(m_handoffFd, info, restore);
+      close(m_handoffFd);
+      m_handoffFd = -1;
+      if (isRestored)
+        LOG(LOG_INFO, "Schedule taken over from previous daemon, %zu events", eventCount());
+    }
+    if (!isRestored && hasInfo && !m_snapshotFilePath.empty()) {
+      isRestored = Snapshot::load(m_snapshotFilePath, info, restore);
+      if (isRestored)
+        LOG(LOG_INFO, "Schedule restored from snapshot, %zu events", eventCount());
+    }
+    if (isRestored)
+      m_configInfo = info;
+    if (!isRestored || m_isDirectory)
+      loadConfig();
+    LOG(LOG_INFO, "Daemon successfully initialized");
 }
 
 void Reminder::checkPid() {
-    syslog(LOG_INFO, "Checking is reminder already running");
-    std::ifstream pidFile(PID_FILEPATH);
+    LOG(LOG_INFO, "Checking is reminder already running");
+    std::ifstream pidFile(m_pidFilePath);
     
-    syslog(LOG_INFO, "Checking if reminder pid file opened");
+    LOG(LOG_INFO, "Checking if reminder pid file opened");
     if (!pidFile.is_open()) {
-        syslog(LOG_INFO, "No running reminder daemon found");
+        LOG(LOG_INFO, "No running reminder daemon found");
     }
-    syslog(LOG_INFO, "Running reminder found");
+    LOG(LOG_INFO, "Running reminder found");
     
-    syslog(LOG_INFO, "Checking if found reminder still exists");
+    LOG(LOG_INFO, "Checking if found reminder still exists");
     pid_t pid{};
     if (pidFile >> pid && !kill(pid, 0)) {
-        syslog(LOG_WARNING, "Stopping a previously running daemon (pid: %i)", pid);
+        // the previous daemon stops firing and passes its live schedule in a memfd,
+        // daemons without control socket are just stopped
+        std::string reply;
+        if (!m_controlFilePath.empty() && ControlSocket::request(m_controlFilePath, "handoff", &reply, &m_handoffFd)
+            && reply.compare(0, 3, "ok ") == 0 && m_handoffFd != -1) {
+            LOG(LOG_WARNING, "Schedule handed over by a previously running daemon (pid: %i)", pid);
+            return;
+        }
+        if (m_handoffFd != -1) {
+            close(m_handoffFd);
+            m_handoffFd = -1;
+        }
+        LOG(LOG_WARNING, "Stopping a previously running daemon (pid: %i)", pid);
         kill(pid, SIGTERM);
     }
 }
 
 void Reminder::toDaemon() {
-    syslog(LOG_INFO, "Starting daemonization");
+    LOG(LOG_INFO, "Starting daemonization");
 
-    syslog(LOG_INFO, "Forking process");
+    LOG(LOG_INFO, "Forking process");
     pid_t pid{ fork() };
     if (pid < 0) {
-        syslog(LOG_ERR, "Forking error");
+        LOG(LOG_ERR, "Forking error");
         exit(EXIT_FAILURE);
     }
     if (pid > 0) {
-        syslog(LOG_INFO, "Successfully forked (parent)");
+        LOG(LOG_INFO, "Successfully forked (parent)");
         exit(EXIT_SUCCESS);
     }
-    syslog(LOG_INFO, "Successfully forked (child)");
+    LOG(LOG_INFO, "Successfully forked (child)");
         
-    syslog(LOG_INFO, "Setting process mask");
+    LOG(LOG_INFO, "Setting process mask");
     umask(0);
 
-    syslog(LOG_INFO, "Setting group");
+    LOG(LOG_INFO, "Setting group");
     if (setsid() < 0) {
-        syslog(LOG_ERR, "Setting group error");
+        LOG(LOG_ERR, "Setting group error");
         exit(EXIT_FAILURE);
     }
     
-    syslog(LOG_INFO, "Changing directory");
+    LOG(LOG_INFO, "Changing directory");
     if (chdir("/") < 0) {
-        syslog(LOG_ERR, "Changing directory error");
+        LOG(LOG_ERR, "Changing directory error");
         exit(EXIT_FAILURE);
     }
 
-    syslog(LOG_INFO, "Successfully daemonized");
+    LOG(LOG_INFO, "Successfully daemonized");
 }
 
 void Reminder::writePid() {
-    syslog(LOG_INFO, "Writing pid");
+    LOG(LOG_INFO, "Writing pid");
 
-    syslog(LOG_INFO, "Checking is reminder pid file opened");
-    std::ofstream pidFile(PID_FILEPATH.c_str());
+    LOG(LOG_INFO, "Checking is reminder pid file opened");
+    std::ofstream pidFile(m_pidFilePath);
     if (!pidFile.is_open()) {
-      syslog(LOG_ERR, "Writing pid error");
+      LOG(LOG_ERR, "Writing pid error");
       exit(EXIT_FAILURE);
     }
 
     pidFile << getpid();
-    syslog(LOG_INFO, "Pid successfully written");
+    LOG(LOG_INFO, "Pid successfully written");
 }
 
-void Reminder::signalHandler(int sig) {
-  syslog(LOG_INFO, "Processing signal: %i", sig);
+void Reminder::setupEvents() {
+    LOG(LOG_INFO, "Setting up event loop");
+
+    LOG(LOG_INFO, "Blocking signals for signalfd");
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGUSR2);
+    if (sigprocmask(SIG_BLOCK, &mask, nullptr) == -1) {
+        LOG(LOG_ERR, "sigprocmask(2) call error: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
 
-  switch (sig) {
-  case SIGHUP:
-    syslog(LOG_INFO, "Reloading config");
-    Reminder::getInstance().loadConfig();
-    break;
-  case SIGTERM:
-    syslog(LOG_INFO, "Terminating process");
-    Reminder::getInstance().terminate();
-    break;
+    if ((m_signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1) {
+        LOG(LOG_ERR, "signalfd(2) call error: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // watch the directory, editors often replace the file instead of writing it
+    if ((m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+        LOG(LOG_ERR, "inotify_init1(2) call error: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    // in directory mode removed files are unloaded too
+    std::string configDir{ m_isDirectory ? m_configFilePath : m_configFilePath.substr(0, m_configFilePath.rfind('/') + 1) };
+    std::uint32_t watchMask{ IN_CLOSE_WRITE | IN_MOVED_TO | (m_isDirectory ? IN_DELETE | IN_MOVED_FROM : 0u) };
+    if (inotify_add_watch(m_inotifyFd, configDir.c_str(), watchMask) == -1) {
+        LOG(LOG_ERR, "inotify_add_watch(2) call error: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    if ((m_epollFd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        LOG(LOG_ERR, "epoll_create1(2) call error: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    for (int fd : { m_signalFd, m_inotifyFd }) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            LOG(LOG_ERR, "epoll_ctl(2) call error: %s", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!m_controlFilePath.empty()) {
+        auto handler = [this](std::string_view line, std::string* reply, int* fd) { handleCommand(line, reply, fd); };
+        if (!m_control.open(m_controlFilePath, m_epollFd, handler))
+            exit(EXIT_FAILURE);
+    }
+
+    LOG(LOG_INFO, "Event loop is set up");
+}
+
+void Reminder::handleSignal() {
+  signalfd_siginfo info;
+  while (read(m_signalFd, &info, sizeof(info)) == sizeof(info)) {
+    LOG(LOG_INFO, "Processing signal: %i", info.ssi_signo);
+
+    switch (info.ssi_signo) {
+    case SIGHUP:
+      LOG(LOG_INFO, "Reloading config");
+      loadConfig();
+      break;
+    case SIGTERM:
+      LOG(LOG_INFO, "Terminating process");
+      terminate();
+      break;
+    case SIGUSR1:
+      LOG(LOG_INFO, "Enabling debug logging");
+      Logger::setLevel(LOG_DEBUG);
+      break;
+    case SIGUSR2:
+      LOG(LOG_INFO, "Restoring log level %i", m_logLevel);
+      Logger::setLevel(m_logLevel);
+      break;
+    }
   }
 }
 
-void Reminder::loadConfig() {
-  syslog(LOG_INFO, "Loading config");
+void Reminder::handleInotify() {
+  alignas(inotify_event) char buf[4096];
+  bool changed{};
+  bool overflowed{};
+  std::unordered_set<std::string> names;  // changed files in directory mode
+  ssize_t len;
+  while ((len = read(m_inotifyFd, buf, sizeof(buf))) > 0) {
+    for (char* ptr{ buf }; ptr < buf + len; ) {
+      auto event = reinterpret_cast<const inotify_event*>(ptr);
+      if (event->mask & IN_Q_OVERFLOW)
+        overflowed = true;
+      else if (event->len && m_isDirectory && isConfigName(event->name))
+        names.insert(event->name);
+      else if (event->len && m_configFileName == event->name)
+        changed = true;
+      ptr += sizeof(inotify_event) + event->len;
+    }
+  }
 
-  syslog(LOG_INFO, "Clearing current event list");
-  m_events.clear();
+  if (changed || overflowed) {
+    LOG(LOG_INFO, "Config file changed, reloading");
+    loadConfig();
+  }
+  else if (!names.empty()) {
+    LOG(LOG_INFO, "%zu config files changed, reloading them", names.size());
+    auto start = std::chrono::steady_clock::now();
+    m_parser.updateOffset();
+    loadFiles(std::vector<std::string>(names.begin(), names.end()));
+    finishLoad(start);
+  }
+}
 
-  syslog(LOG_INFO, "Checking is config file opened");
-  std::ifstream configFile(m_configFilePath);
-  if (!configFile.is_open()) {
-    syslog(LOG_ERR, "Config file already opened");
-    m_isTerminated = true;
+// commands, one per line:
+// "add_event ..." in config syntax, replies "ok <key>"
+// "remove <key>", replies "ok"
+// "list", replies "<key> <time> <repeat seconds> <text>" per event and "ok <count>"
+// "stats", replies histogram and counter lines and "ok"
+// "handoff", stops firing, replies "ok <count>" with schedule snapshot memfd and terminates
+// failures reply "error <reason>"
+void Reminder::handleCommand(std::string_view line, std::string* reply, int* fd) {
+  LOG(LOG_DEBUG, "Processing control command: %.*s", static_cast<int>(line.size()), line.data());
+
+  std::string_view command{ line.substr(0, line.find(' ')) };
+  std::string_view arg{ line.substr(command.size()) };
+  while (!arg.empty() && arg.front() == ' ')
+    arg.remove_prefix(1);
+
+  if (command.empty()) {
     return;
   }
+  else if (command == "add_event") {
+    TextEvent event;
+    if (!parseEvent(line, &event)) {
+      *reply += "error invalid event\n";
+      return;
+    }
+    std::uint64_t key{ m_controlKey++ };
+    event.event.key = key;
+    shardOf(key).add(event);
+    *reply += "ok " + std::to_string(key) + '\n';
+  }
+  else if (command == "remove") {
+    std::uint64_t key{};
+    auto res = std::from_chars(arg.data(), arg.data() + arg.size(), key);
+    if (res.ec != std::errc() || res.ptr != arg.data() + arg.size())
+      *reply += "error invalid key\n";
+    else if (!shardOf(key).remove(key))
+      *reply += "error unknown key\n";
+    else
+      *reply += "ok\n";
+  }
+  else if (command == "list") {
+    std::vector<Snapshot::Entry> entries;
+    for (auto& shard : m_shards)
+      shard->collect(&entries);
+    std::sort(entries.begin(), entries.end(), [](const Snapshot::Entry& a, const Snapshot::Entry& b) {
+      return a.event.time < b.event.time;
+    });
+
+    for (auto& entry : entries) {
+      std::time_t time{ std::chrono::system_clock::to_time_t(entry.event.time) };
+      std::tm tm;
+      localtime_r(&time, &tm);
+      char buf[32];
+      std::strftime(buf, sizeof(buf), "%d/%m/%Y %H:%M:%S", &tm);
+      *reply += std::to_string(entry.key) + ' ' + buf + ' ' + std::to_string(entry.event.repeat.count())
+          + ' ' + std::string(entry.text) + '\n';
+    }
+    *reply += "ok " + std::to_string(entries.size()) + '\n';
+  }
+  else if (command == "stats") {
+    Metrics::getInstance().report(reply);
+    Dispatcher::Stats stats{ m_dispatcher.stats() };
+    *reply += "events count=" + std::to_string(eventCount()) + '\n';
+    *reply += "notifications submitted=" + std::to_string(stats.submitted)
+        + " dropped=" + std::to_string(stats.dropped)
+        + " delivered=" + std::to_string(stats.delivered)
+        + " merged=" + std::to_string(stats.merged)
+        + " spawned=" + std::to_string(stats.spawned)
+        + " failed=" + std::to_string(stats.failed)
+        + " max_queue=" + std::to_string(stats.maxDepth) + '\n';
+    *reply += "ok\n";
+  }
+  else if (command == "handoff") {
+    LOG(LOG_WARNING, "Handing schedule over to a new daemon");
+    // nothing fires after the schedule is taken, due events fire late in the new daemon
+    for (auto& shard : m_shards)
+      shard->stop();
+
+    std::vector<Snapshot::Entry> entries;
+    collectEntries(&entries);
+    int memFd{ memfd_create("reminder_handoff", MFD_CLOEXEC) };
+    if (memFd == -1 || !Snapshot::write(memFd, m_configInfo, entries)) {
+      LOG(LOG_ERR, "Schedule handoff error: %s", memFd == -1 ? strerror(errno) : "snapshot write failed");
+      if (memFd != -1)
+        close(memFd);
+      for (auto& shard : m_shards)
+        shard->start();
+      *reply += "error handoff failed\n";
+      return;
+    }
+    *fd = memFd;
+    *reply += "ok " + std::to_string(entries.size()) + '\n';
+    m_isHandedOff = true;
+    terminate();
+  }
+  else {
+    *reply += "error unknown command\n";
+  }
+}
 
-  syslog(LOG_INFO, "Processing config file");
-  std::string str;
-  while (std::getline(configFile, str)) {
-    syslog(LOG_INFO, "Processing config file line: %s", str.c_str());
-    if (std::regex_match(str, EVENT_REGEX)) {
-      syslog(LOG_INFO, "String matches event regex");
-      parseEvent(str);
+void Reminder::loadConfig() {
+  LOG(LOG_INFO, "Loading config");
+  auto start = std::chrono::steady_clock::now();
+
+  LOG(LOG_INFO, "Caching UTC offset");
+  m_parser.updateOffset();
+
+  if (m_isDirectory) {
+    // files loaded before may be gone, loading them removes their events
+    std::vector<std::string> names{ listConfigs() };
+    std::unordered_set<std::string> listed(names.begin(), names.end());
+    for (auto& file : m_configKeys)
+      if (!listed.count(file.first))
+        names.push_back(file.first);
+    loadFiles(names);
+
+    // restored lines that no config file has anymore
+    if (!m_restoredKeys.empty()) {
+      for (auto& file : m_configKeys)
+        for (std::uint64_t key : file.second)
+          m_restoredKeys.erase(key);
+      LOG(LOG_INFO, "Removing %zu restored events of deleted lines", m_restoredKeys.size());
+      for (std::uint64_t key : m_restoredKeys)
+        shardOf(key).remove(key);
+      m_restoredKeys.clear();
     }
-        else {
-      syslog(LOG_WARNING, "Failed to parse string. Ignoring");
+  }
+  else {
+    // taken before reading, so a concurrent edit makes the snapshot stale
+    LOG(LOG_INFO, "Getting config file state");
+    if (!Snapshot::configInfo(m_configFilePath, &m_configInfo))
+      m_configInfo = {};
+
+    m_configKeys[m_configFileName];
+    if (!loadFile(m_configFileName, true)) {
+      m_isTerminated = true;
+      return;
     }
   }
-  syslog(LOG_INFO, "Config file processing finished");
 
-  if (m_events.empty())
-    syslog(LOG_WARNING, "No reminder events found");
+  finishLoad(start);
+}
+
+void Reminder::loadFiles(const std::vector<std::string>& names) {
+  // entries are created up front, workers only touch entries of their own files
+  for (auto& name : names)
+    m_configKeys[name];
+
+  std::vector<char> isLoaded(names.size());
+  std::atomic<std::size_t> next{};
+  auto work = [&]() {
+    for (std::size_t i; (i = next++) < names.size(); )
+      isLoaded[i] = loadFile(names[i], false);
+  };
+
+  std::size_t threadCnt{ std::min(m_loadThreads, names.size()) };
+  LOG(LOG_INFO, "Loading %zu config files in %zu threads", names.size(), threadCnt);
+  if (threadCnt <= 1) {
+    work();
+  }
+  else {
+    std::vector<std::thread> workers;
+    for (std::size_t i{}; i < threadCnt; ++i)
+      workers.emplace_back(work);
+    for (auto& worker : workers)
+      worker.join();
+  }
+
+  for (std::size_t i{}; i < names.size(); ++i)
+    if (!isLoaded[i])
+      m_configKeys.erase(names[i]);
+}
+
+bool Reminder::loadFile(const std::string& name, bool isParallel) {
+  std::string path{ m_isDirectory ? m_configFilePath + '/' + name : m_configFilePath };
+  std::unordered_set<std::uint64_t>& fileKeys = m_configKeys.find(name)->second;
+
+  LOG(LOG_INFO, "Checking is config file opened");
+  std::ifstream configFile(path, std::ios::binary);
+  bool isOpened{ configFile.is_open() };
+  if (!isOpened && !m_isDirectory) {
+    LOG(LOG_ERR, "Config file already opened");
+    return false;
+  }
+  // a removed file of config directory loads as empty
+  std::string content;
+  if (isOpened)
+    content.assign(std::istreambuf_iterator<char>(configFile), std::istreambuf_iterator<char>());
+
+  // lines are keyed by content hash and occurrence number,
+  // events of unchanged lines are kept with their next time
+  LOG(LOG_INFO, "Processing config file %s", name.c_str());
+  std::uint64_t seed{ m_isDirectory ? hashBytes(name) : hashBytes({}) };
+  std::size_t shardCnt{ m_shards.size() };
+  std::unordered_set<std::uint64_t> configKeys;
+  std::unordered_map<std::uint64_t, std::size_t> occurrences;
+  std::vector<std::vector<std::pair<std::uint64_t, std::string_view>>> addedLines(shardCnt);
+  std::vector<std::vector<std::uint64_t>> removedKeys(shardCnt);
+  std::size_t kept{}, removed{};
+  std::string_view rest{ content };
+  while (!rest.empty()) {
+    std::size_t end{ std::min(rest.find('\n'), rest.size()) };
+    std::string_view line{ rest.substr(0, end) };
+    rest.remove_prefix(std::min(end + 1, rest.size()));
+
+    std::uint64_t hash{ hashBytes(line, seed) };
+    std::uint64_t key{ (hash + occurrences[hash]++ * 0x9e3779b97f4a7c15ull) & ~CONTROL_KEY_BIT };
+    configKeys.insert(key);
+    // restored keys are only read here, loadConfig drops the matched ones afterwards
+    if (fileKeys.erase(key) || m_restoredKeys.count(key))
+      ++kept;
+    else
+      addedLines[key % shardCnt].push_back({ key, line });
+  }
+
+  LOG(LOG_INFO, "Removing events of deleted lines");
+  for (std::uint64_t key : fileKeys) {
+    removedKeys[key % shardCnt].push_back(key);
+    ++removed;
+  }
+  fileKeys.swap(configKeys);
+
+  // every worker parses lines of its own shard, so shards are updated without contention
+  std::atomic<std::size_t> added{};
+  auto parseShard = [&](std::size_t i) {
+    std::vector<TextEvent> events;
+    events.reserve(addedLines[i].size());
+    for (auto& line : addedLines[i]) {
+      LOG(LOG_DEBUG, "Processing config file line: %.*s", static_cast<int>(line.second.size()), line.second.data());
+      TextEvent event;
+      if (parseEvent(line.second, &event)) {
+        event.event.key = line.first;
+        events.push_back(event);
+      }
+    }
+    added += events.size();
+    if (!removedKeys[i].empty() || !events.empty())
+      m_shards[i]->update(removedKeys[i], events);
+  };
+
+  // files of config directory are already loaded in parallel
+  if (shardCnt == 1 || !isParallel) {
+    for (std::size_t i{}; i < shardCnt; ++i)
+      parseShard(i);
+  }
+  else {
+    std::vector<std::thread> workers;
+    for (std::size_t i{}; i < shardCnt; ++i)
+      workers.emplace_back(parseShard, i);
+    for (auto& worker : workers)
+      worker.join();
+  }
+  LOG(LOG_INFO, "Config file %s processing finished", name.c_str());
+  LOG(LOG_INFO, "Events kept: %zu, added: %zu, removed: %zu", kept, added.load(), removed);
+  return isOpened;
+}
+
+void Reminder::finishLoad(std::chrono::steady_clock::time_point start) {
+  std::size_t eventCnt{ eventCount() };
+  if (!eventCnt)
+    LOG(LOG_WARNING, "No reminder events found");
   else
-    syslog(LOG_INFO, "%li reminder events found", m_events.size());
+    LOG(LOG_INFO, "%zu reminder events found", eventCnt);
 
-  syslog(LOG_INFO, "Config loaded");
+  saveSnapshot();
+  Metrics::getInstance().configLoad.record(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count());
+  LOG(LOG_INFO, "Config loaded");
 }
 
-void Reminder::parseEvent(std::string& line) {
-  syslog(LOG_INFO, "Parsing event string");
+std::vector<std::string> Reminder::listConfigs() const {
+  std::vector<std::string> names;
+  DIR* dir{ opendir(m_configFilePath.c_str()) };
+  if (!dir) {
+    LOG(LOG_ERR, "opendir(3) call error: %s", strerror(errno));
+    return names;
+  }
+
+  while (dirent* entry = readdir(dir)) {
+    if (!isConfigName(entry->d_name))
+      continue;
+    bool isRegular{ entry->d_type == DT_REG };
+    if (entry->d_type == DT_UNKNOWN) {
+      struct stat st;
+      isRegular = stat((m_configFilePath + '/' + entry->d_name).c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    }
+    if (isRegular)
+      names.push_back(entry->d_name);
+  }
+  closedir(dir);
+  return names;
+}
 
-  std::smatch match;
-  syslog(LOG_INFO, "Parsing event string 2");
-  std::regex_search(line, match, EVENT_REGEX);
+bool Reminder::isConfigName(const char* name) {
+  std::string_view str{ name };
+  return !str.empty() && str.front() != '.' && str.back() != '~'
+      && (str.size() < 4 || str.substr(str.size() - 4) != ".tmp");
+}
 
-  syslog(LOG_INFO, "Parsing event time");
-  std::tm tmEventTime;
-  if ((std::istringstream(match[1]) >> std::get_time(&tmEventTime, "%d/%m/%Y %T")).fail()) {
-    syslog(LOG_WARNING, "Failed to parse time, event will be ignored");
+void Reminder::saveSnapshot() {
+  if (m_snapshotFilePath.empty())
     return;
+  LOG(LOG_INFO, "Saving schedule snapshot");
+
+  std::vector<Snapshot::Entry> entries;
+  collectEntries(&entries);
+  if (Snapshot::save(m_snapshotFilePath, m_configInfo, entries))
+    LOG(LOG_INFO, "Schedule snapshot saved");
+}
+
+void Reminder::collectEntries(std::vector<Snapshot::Entry>* entries) const {
+  for (auto& shard : m_shards)
+    shard->collect(entries);
+
+  std::unordered_set<std::uint64_t> pending;
+  for (auto& entry : *entries)
+    pending.insert(entry.key);
+  for (auto& file : m_configKeys)
+    for (std::uint64_t key : file.second)
+      if (!pending.count(key))
+        entries->push_back({ key, false, {} });
+}
+
+Shard& Reminder::shardOf(std::uint64_t key) {
+  return *m_shards[key % m_shards.size()];
+}
+
+std::size_t Reminder::eventCount() const {
+  std::size_t cnt{};
+  for (auto& shard : m_shards)
+    cnt += shard->size();
+  return cnt;
+}
+
+bool Reminder::parseEvent(std::string_view line, TextEvent* event) {
+  LOG(LOG_DEBUG, "Parsing event string");
+
+  ConfigParser::Line parsed;
+  switch (m_parser.parse(line, &parsed)) {
+  case ConfigParser::Status::SYNTAX:
+    LOG(LOG_WARNING, "Failed to parse string. Ignoring");
+    return false;
+  case ConfigParser::Status::TIME:
+    LOG(LOG_WARNING, "Failed to parse time, event will be ignored");
+    return false;
+  case ConfigParser::Status::OK:
+    break;
   }
-  auto eventTime = std::chrono::system_clock::from_time_t(std::mktime(&tmEventTime));
-  syslog(LOG_INFO, "Event time parsed");
-
-  syslog(LOG_INFO, "Parsing event repetition");
-  int seconds{};
-  if (match[2] != "") {
-    if (match[2] == "-m")
-      seconds = 60;
-    else if (match[2] == "-h")
-      seconds = 60 * 60;
-    else if (match[2] == "-d")
-      seconds = 24 * 60 * 60;
-    else if (match[2] == "-w")
-      seconds = 7 * 24 * 60 * 60;
-    else
-      syslog(LOG_WARNING, "Failed to parse repeat interval, ignoring");
-  }
-  syslog(LOG_INFO, "Event repetition %s",
-         seconds ? "parsed" : "isn't specified"
+  event->event.time = parsed.time;
+  event->event.repeat = parsed.repeat;
+  event->event.rule = parsed.rule;
+  LOG(LOG_DEBUG, "Event parsed, repetition %s",
+         parsed.repeat.count() || !parsed.rule.empty() ? "parsed" : "isn't specified"
          );
-  std::chrono::seconds repeat{ seconds };
 
-  syslog(LOG_INFO, "Processing event time");
-  auto now = std::chrono::system_clock::now();
-  if (eventTime < now) {
-    if (repeat == std::chrono::seconds(0)) {
-      syslog(LOG_WARNING, "Event time has passed, event will be ignored");
-      return;
+  LOG(LOG_DEBUG, "Processing event time");
+  auto now = m_clock->now();
+  if (!parsed.rule.empty()) {
+    if (!parsed.rule.next(now, m_parser.utcOffset(), &event->event.time)) {
+      LOG(LOG_WARNING, "Recurrence rule never matches, event will be ignored");
+      return false;
     }
+    event->text = parsed.text;
+    return true;
+  }
 
-    auto delta = now - eventTime;
-    auto step = delta / repeat + (delta % repeat == std::chrono::seconds(0) ? 0 : 1);
-    eventTime += std::chrono::duration_cast<std::chrono::seconds>(step * repeat);
+  std::int64_t due{ dueCount(event->event, now) };
+  if (due) {
+    if (parsed.repeat == std::chrono::seconds(0)) {
+      LOG(LOG_WARNING, "Event time has passed, event will be ignored");
+      return false;
+    }
+    event->event.time += parsed.repeat * due;
   }
-  syslog(LOG_INFO, "Event time processed");
+  LOG(LOG_DEBUG, "Event time processed");
 
-  m_events.push_back({ eventTime, repeat, match[3] });
-  syslog(LOG_INFO, "Event added to list");
+  event->text = parsed.text;
+  return true;
 }
 
 void Reminder::terminate() {
-  syslog(LOG_WARNING, "Terminating process");
+  LOG(LOG_WARNING, "Terminating process");
   m_isTerminated = true;
-
-  syslog(LOG_INFO, "Closing logger");
-  closelog();
 }
 
 void Reminder::run() {
-  syslog(LOG_INFO, "Reminder daemon is working");
+  LOG(LOG_INFO, "Reminder daemon is working");
 
+  epoll_event events[MAX_EPOLL_EVENTS];
   while (!m_isTerminated) {
-    auto now = std::chrono::system_clock::now();
-    auto next = now + SLEEP_TIME;
+    int cnt{ epoll_wait(m_epollFd, events, MAX_EPOLL_EVENTS, -1) };
+    if (cnt == -1) {
+      if (errno != EINTR)
+        LOG(LOG_ERR, "epoll_wait(2) call error: %s", strerror(errno));
+      continue;
+    }
+    LOG(LOG_DEBUG, "Waking up");
+
+    for (int i{}; i < cnt; ++i) {
+      if (events[i].data.fd == m_signalFd)
+        handleSignal();
+      else if (events[i].data.fd == m_inotifyFd)
+        handleInotify();
+      else if (m_control.owns(events[i].data.fd))
+        m_control.handle(events[i].data.fd, events[i].events);
+    }
+  }
 
-    for (auto e = m_events.begin(); e != m_events.end(); ++e) {
-      if (now < e->time) {
-        next = std::min(next, e->time);
-        continue;
-      }
+  LOG(LOG_INFO, "Stopping shards");
+  for (auto& shard : m_shards)
+    shard->stop();
 
-      syslog(LOG_INFO, "%s", e->text.c_str());
-      std::string text = "gnome-terminal -- bash -c \"echo '" + e->text + "'; read n\"";
-      system(text.c_str());
+  // keeps next times of events for restart, after handoff the new daemon owns the snapshot
+  if (!m_isHandedOff)
+    saveSnapshot();
 
-      if (e->repeat != std::chrono::seconds(0))
-        e->time += e->repeat;
-      else
-        m_events.erase(e--);
-    }
+  LOG(LOG_INFO, "Stopping dispatcher");
+  m_dispatcher.stop();
+  Dispatcher::Stats stats{ m_dispatcher.stats() };
+  LOG(LOG_INFO, "Notifications submitted: %lu, dropped: %lu, delivered: %lu, merged: %lu, spawned: %lu, failed: %lu, max queue: %zu",
+         stats.submitted, stats.dropped, stats.delivered, stats.merged, stats.spawned, stats.failed, stats.maxDepth);
+
+  // the new daemon has bound the control socket path already
+  m_control.close(m_isHandedOff);
+  close(m_epollFd);
+  close(m_inotifyFd);
+  close(m_signalFd);
+  LOG(LOG_INFO, "Terminated");
 
-    std::time_t tt = std::chrono::system_clock::to_time_t(next);
-    std::tm tm = *std::localtime(&tt);
-    std::stringstream ss;
-    ss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+  Logger::getInstance().stop();
+  syslog(LOG_INFO, "Closing logger");
+  closelog();
+}
 
-    syslog(LOG_INFO, "Sleeping until: %s", ss.str().c_str());
-    try {
-      std::this_thread::sleep_until(next);
-    } catch (const std::exception& e) {
-      syslog(LOG_ERR, "Exception catched trying to sleep, next iteration");
+void Reminder::simulate() {
+  LOG(LOG_INFO, "Reminder daemon is simulating");
+
+  // every step jumps to the earliest deadline of all shards, idle time costs nothing
+  Clock::TimePoint start{ m_simClock->now() };
+  Clock::TimePoint end{ start + m_simulateSpan };
+  std::size_t eventCnt{ eventCount() };
+  std::uint64_t steps{}, fired{};
+  std::clock_t cpuStart{ std::clock() };
+  auto wallStart = std::chrono::steady_clock::now();
+  for (;;) {
+    Clock::TimePoint next{ Clock::TimePoint::max() };
+    for (auto& shard : m_shards) {
+      Clock::TimePoint time;
+      if (shard->next(&time))
+        next = std::min(next, time);
     }
-    syslog(LOG_INFO, "Waking up");
+    if (next > end)
+      break;
+
+    m_simClock->set(std::max(next, m_simClock->now()));
+    for (auto& shard : m_shards)
+      fired += shard->tick();
+    ++steps;
   }
-  syslog(LOG_INFO, "Terminated");
+  double cpu{ static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC };
+  double wall{ std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count() };
+
+  LOG(LOG_INFO, "Simulation finished, %lu steps, %lu events fired", steps, fired);
+  std::printf("{\"simulated_s\":%li,\"events\":%zu,\"steps\":%lu,\"fired\":%lu,"
+              "\"wall_s\":%.3f,\"cpu_s\":%.3f,\"cpu_ns_per_fired\":%.1f}\n",
+              static_cast<long>(m_simulateSpan.count()), eventCnt, steps, fired,
+              wall, cpu, fired ? cpu * 1e9 / fired : 0.0);
+
+  Logger::getInstance().stop();
+  closelog();
 }
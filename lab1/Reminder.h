@@ -1,32 +1,63 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
-#include <regex>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "Clock.h"
+#include "ConfigParser.h"
+#include "ControlSocket.h"
+#include "Dispatcher.h"
+#include "Logger.h"
+#include "Shard.h"
+#include "Snapshot.h"
+
 // singleton reminder daemon class
 class Reminder {
-    // regex for reading events from config
-    const std::regex EVENT_REGEX{
-        R"(^\s*add_event\s+(\S+\s+\S+)\s+(-m|-h|-d|-w)*\s*(.+)\s*)"
-    };
-    
-    // filepath for pid file
-    const std::string PID_FILEPATH{ "/var/run/reminder_daemon.pid" };
-    
-    // sleep time between checking events
-    const std::chrono::seconds SLEEP_TIME{ std::chrono::seconds(10) };
-    
-    struct Event {
-        std::chrono::system_clock::time_point time{};   // event time
-        std::chrono::seconds repeat{};  // repetition time (minute/hour/day/week)
-        std::string text{}; // text to remind
-    };
+    // max fds reported by one epoll_wait call
+    static constexpr int MAX_EPOLL_EVENTS{ 8 };
 
+    // set in keys of events added through control socket, cleared in config line keys
+    static constexpr std::uint64_t CONTROL_KEY_BIT{ 1ull << 63 };
+    
     bool m_isTerminated{};  // is daemon terminated
-    std::string m_configFilePath{}; // filepath to config file
-    std::vector<Event> m_events{};  // list of actual events
+    std::string m_configFilePath{}; // filepath to config file or directory
+    std::string m_configFileName{}; // config name inside its directory, empty in directory mode
+    bool m_isDirectory{};   // every file of the config directory is a config of its own
+    std::size_t m_loadThreads{};    // config directory loading threads
+    std::string m_logFilePath{};    // log file, empty for syslog
+    std::string m_pidFilePath{};    // pid file, empty if not used
+    std::string m_controlFilePath{};    // control socket, empty if disabled
+    std::string m_snapshotFilePath{};   // schedule snapshot, empty if disabled
+    int m_logLevel{};   // log level to restore after debugging
+    ConfigParser m_parser{};    // config line parser
+    Dispatcher m_dispatcher{};  // launches notifiers for fired events
+    // actual events split by key between scheduler threads
+    std::vector<std::unique_ptr<Shard>> m_shards{};
+    // keys (content hash and occurrence) of config lines by config file name, with or without pending event,
+    // in directory mode the hash is seeded with file name, so every file has a key namespace of its own
+    std::unordered_map<std::string, std::unordered_set<std::uint64_t>> m_configKeys{};
+    // config line keys restored from snapshot in directory mode, not yet matched with config files
+    std::unordered_set<std::uint64_t> m_restoredKeys{};
+    Snapshot::ConfigInfo m_configInfo{};    // config file state of loaded events
+    std::uint64_t m_controlKey{ CONTROL_KEY_BIT };  // key of next event added through control socket
+    ControlSocket m_control{};  // runtime schedule changes
+    std::unique_ptr<SimulatedClock> m_simClock{};   // set in simulation mode
+    const Clock* m_clock{ &Clock::system() };   // time source of shards and config loads
+    std::chrono::seconds m_simulateSpan{};  // simulated time to replay
+    int m_handoffFd{ -1 };  // schedule snapshot received from previous daemon
+    bool m_isHandedOff{};   // schedule was passed to a new daemon
+
+    int m_epollFd{ -1 };    // epoll set of the fds below
+    int m_signalFd{ -1 };   // SIGHUP, SIGTERM, SIGUSR1 and SIGUSR2
+    int m_inotifyFd{ -1 };  // config directory changes
 
     // singleton
     Reminder() {}
@@ -34,19 +65,58 @@ class Reminder {
     Reminder& operator=(const Reminder&) = delete;
 
   public:
+    // daemon settings from command line
+    struct Options {
+        std::string configPath{};   // relative or absolute filepath to config file or directory
+        std::size_t loadThreads{ std::max(std::thread::hardware_concurrency(), 1u) };  // config directory loading threads
+        bool daemonize{ true }; // fork and detach, otherwise stay in foreground
+        std::string pidPath{ "/var/run/reminder_daemon.pid" };  // empty skips pid check and write
+        std::string controlPath{ "/var/run/reminder_daemon.sock" }; // empty disables control socket
+        std::string snapshotPath{ "/var/tmp/reminder_daemon.snapshot" };    // empty disables snapshots
+        std::string scheduler{ "heap" };    // event timer structure (heap/wheel)
+        std::size_t shards{ 1 };    // scheduler threads
+        Shard::MissedPolicy missed{ Shard::MissedPolicy::ONCE };    // missed repeating events handling
+        // notifier argv, Dispatcher::TEXT_PLACEHOLDER is replaced with event text
+        std::vector<std::string> notifier{
+            "gnome-terminal", "--", "bash", "-c", "echo \"$0\"; read n", Dispatcher::TEXT_PLACEHOLDER
+        };
+        std::string sinkPath{}; // file or fifo written instead of launching notifier
+        std::size_t dispatchThreads{ 2 };   // notifier launching threads
+        std::size_t dispatchQueue{ 1024 };  // max pending notifications
+        // ms to gather notifications into one, Dispatcher::NO_BATCHING delivers each of them
+        std::chrono::milliseconds batchWindow{ Dispatcher::NO_BATCHING };
+        int logLevel{ LOG_INFO };   // max syslog level written, SIGUSR1 raises it to LOG_DEBUG
+        std::string logPath{};  // relative or absolute log file, empty for syslog
+        // replay this span of schedule on a simulated clock instead of running, zero runs the daemon
+        std::chrono::seconds simulate{};
+    };
+
     static Reminder& getInstance(); // get singleton instance
 
-    void init(std::string configPath); // init with config    
+    void init(const Options& options); // init with config    
     void run(); // start working
+    void simulate();    // replay schedule jumping from deadline to deadline, print report to stdout
 
   private:
-    void checkPid();    // check running daemon
+    void checkPid();    // take schedule over from running daemon or stop it
     void toDaemon();    // turn process into daemon
     void writePid();    // write new pid to pid file
-    static void signalHandler(int sig); // signal handler for SIGHUP and SIGTERM
+    void setupEvents(); // create epoll set with signalfd and inotify
+    void handleSignal();    // process pending signals
+    void handleInotify();   // reload config if it was changed
+    void handleCommand(std::string_view line, std::string* reply, int* fd); // execute control command
 
-    void loadConfig();  // read events from config
-    void parseEvent(std::string& line); // parse string with event
+    void loadConfig();  // read events from all configs, keeping events of unchanged lines
+    void loadFiles(const std::vector<std::string>& names);  // reload listed files of config directory in parallel
+    bool loadFile(const std::string& name, bool isParallel);    // false if config file can't be read
+    void finishLoad(std::chrono::steady_clock::time_point start);   // report events, save snapshot
+    std::vector<std::string> listConfigs() const;   // config files of config directory
+    static bool isConfigName(const char* name); // skips hidden, backup and temporary files
+    bool parseEvent(std::string_view line, TextEvent* event);   // parse string with event, text points into line
+    void saveSnapshot();    // write schedule snapshot for fast restart
+    void collectEntries(std::vector<Snapshot::Entry>* entries) const;   // events and config lines for snapshot
+    Shard& shardOf(std::uint64_t key);  // shard owning event key
+    std::size_t eventCount() const; // events in all shards
 
     void terminate();   // terminate process
 };
\ No newline at end of file
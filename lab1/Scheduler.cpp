@@ -0,0 +1,12 @@
+#include "EventQueue.h"
+#include "TimingWheel.h"
+
+constexpr Scheduler::Id Scheduler::NONE;
+
+Scheduler* Scheduler::create(const std::string& type) {
+    if (type == "heap")
+        return new EventQueue();
+    if (type == "wheel")
+        return new TimingWheel();
+    return nullptr;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "Event.h"
+
+// event timer structure used by the daemon
+// ids stay valid until the event is removed
+class Scheduler {
+  public:
+    using Id = std::size_t;
+    using TimePoint = std::chrono::system_clock::time_point;
+
+    static constexpr Id NONE{ static_cast<Id>(-1) };   // invalid id
+
+    virtual ~Scheduler() = default;
+
+    // create scheduler by name ("heap" or "wheel"), nullptr if unknown
+    static Scheduler* create(const std::string& type);
+
+    virtual Id push(Event event) = 0;   // add event
+    virtual bool remove(Id id) = 0; // remove event
+    virtual void reschedule(Id id, TimePoint time) = 0;    // move event to new time
+
+    // get event due at now, it stays due until rescheduled or removed
+    virtual bool poll(TimePoint now, Id* id) = 0;
+    // earliest time an event may become due, false if there are no events
+    virtual bool next(TimePoint* time) const = 0;
+
+    virtual Event& get(Id id) = 0;  // event by id
+    virtual const Event& get(Id id) const = 0;  // event by id
+
+    virtual std::size_t size() const = 0;
+    virtual void clear() = 0;
+
+    bool empty() const { return size() == 0; }
+};
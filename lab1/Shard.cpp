@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "Metrics.h"
+#include "Shard.h"
+
+Shard::Shard(std::size_t index, Scheduler* events, Dispatcher* dispatcher, MissedPolicy missed, const Clock* clock)
+    : m_index(index), m_dispatcher(dispatcher), m_missed(missed), m_clock(clock), m_events(events) {}
+
+Shard::~Shard() {
+    stop();
+    if (m_timerFd != -1)
+        close(m_timerFd);
+}
+
+bool Shard::start() {
+    // blocking timer, the firing thread sleeps in read(2), kept over restarts
+    if (m_timerFd == -1 && (m_timerFd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC)) == -1) {
+        LOG(LOG_ERR, "timerfd_create(2) call error: %s", strerror(errno));
+        return false;
+    }
+
+    m_isStopped.store(false);
+    m_thread = std::thread(&Shard::loop, this);
+    return true;
+}
+
+void Shard::stop() {
+    if (!m_thread.joinable())
+        return;
+
+    m_isStopped.store(true);
+    // wake the firing thread right away
+    itimerspec spec{};
+    spec.it_value.tv_nsec = 1;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_armedTime = Scheduler::TimePoint::min();
+        timerfd_settime(m_timerFd, 0, &spec, nullptr);
+    }
+    m_thread.join();
+}
+
+void Shard::update(const std::vector<std::uint64_t>& removed, const std::vector<TextEvent>& added) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (std::uint64_t key : removed)
+        erase(key);
+    for (const TextEvent& event : added)
+        insert(event);
+    if (m_pool.deadBytes() > m_pool.liveBytes() && m_pool.deadBytes() > MIN_GARBAGE)
+        compact();
+    armTimer();
+}
+
+void Shard::add(const TextEvent& event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    insert(event);
+    armTimer();
+}
+
+bool Shard::remove(std::uint64_t key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return erase(key);
+}
+
+void Shard::collect(std::vector<Snapshot::Entry>* entries) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& key : m_keys) {
+        const Event& event = m_events->get(key.second);
+        entries->push_back({ key.first, true, event, m_pool.get(event.text) });
+    }
+}
+
+std::size_t Shard::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_events->size();
+}
+
+std::uint64_t Shard::tick() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return fire();
+}
+
+bool Shard::next(Scheduler::TimePoint* time) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_events->next(time);
+}
+
+void Shard::loop() {
+    LOG(LOG_INFO, "Shard %zu is working", m_index);
+
+    while (!m_isStopped.load()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            fire();
+            // timer expired or was cancelled, arm it in any case
+            m_armedTime = Scheduler::TimePoint::min();
+            armTimer();
+        }
+
+        // ECANCELED after clock change is fine, deadlines are checked anyway
+        std::uint64_t expirations;
+        if (read(m_timerFd, &expirations, sizeof(expirations)) == -1 && errno != ECANCELED && errno != EINTR)
+            LOG(LOG_ERR, "read(2) call error for timerfd: %s", strerror(errno));
+        LOG(LOG_DEBUG, "Shard %zu waking up", m_index);
+    }
+
+    LOG(LOG_INFO, "Shard %zu stopped", m_index);
+}
+
+std::uint64_t Shard::fire() {
+    auto start = std::chrono::steady_clock::now();
+    auto now = m_clock->now();
+
+    // rules are matched in local time, the offset is taken once per wakeup
+    std::time_t tt{ std::chrono::system_clock::to_time_t(now) };
+    std::tm tm{};
+    localtime_r(&tt, &tm);
+    long utcOffset{ tm.tm_gmtoff };
+
+    Metrics& metrics{ Metrics::getInstance() };
+    std::vector<std::string> texts; // submitted at once, so a tick reaches the dispatcher as one batch
+    std::uint64_t fired{};
+    Scheduler::Id id{};
+    while (m_events->poll(now, &id)) {
+        Event& e = m_events->get(id);
+        metrics.lateness.record(std::max<std::int64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - e.time).count(), 0));
+        std::string_view text{ m_pool.get(e.text) };
+
+        // older occurrences of a repeating event were missed, the latest one is just late
+        std::int64_t due{ dueCount(e, now) };
+        std::int64_t fires{ due };
+        if (due > 1) {
+            LOG(LOG_INFO, "Event missed %li times: %.*s", due - 1, static_cast<int>(text.size()), text.data());
+            if (m_missed == MissedPolicy::ONCE)
+                fires = 1;
+            else if (m_missed == MissedPolicy::SKIP)
+                fires = 0;
+        }
+        for (std::int64_t i{}; i < fires; ++i) {
+            LOG(LOG_INFO, "%.*s", static_cast<int>(text.size()), text.data());
+            if (m_dispatcher)
+                texts.emplace_back(text);
+        }
+        fired += fires;
+
+        Scheduler::TimePoint next;
+        if (e.repeat != std::chrono::seconds(0)) {
+            m_events->reschedule(id, e.time + e.repeat * due);
+        }
+        else if (!e.rule.empty() && e.rule.next(now, utcOffset, &next)) {
+            m_events->reschedule(id, next);
+        }
+        else {
+            // config line stays, but has no pending event anymore
+            m_keys.erase(e.key);
+            m_pool.release(e.text);
+            m_events->remove(id);
+        }
+    }
+    if (!texts.empty() && m_dispatcher)
+        m_dispatcher->submit(std::move(texts));
+    metrics.tickEvents.record(fired);
+    metrics.tickTime.record(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    return fired;
+}
+
+void Shard::armTimer() {
+    if (m_timerFd == -1)
+        return;
+
+    // disarmed timer when there are no events, only stop() wakes the thread
+    itimerspec spec{};
+    Scheduler::TimePoint next{ Scheduler::TimePoint::max() };
+    if (m_events->next(&next)) {
+        auto since = next.time_since_epoch();
+        auto sec = std::chrono::duration_cast<std::chrono::seconds>(since);
+        spec.it_value.tv_sec = sec.count();
+        spec.it_value.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(since - sec).count();
+        // zero value disarms the timer, deadlines at the epoch are long due anyway
+        if (!spec.it_value.tv_sec && !spec.it_value.tv_nsec)
+            spec.it_value.tv_nsec = 1;
+
+        if (Logger::isEnabled(LOG_DEBUG)) {
+            std::time_t tt = std::chrono::system_clock::to_time_t(next);
+            std::tm tm = *std::localtime(&tt);
+            std::stringstream ss;
+            ss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+            LOG(LOG_DEBUG, "Shard %zu sleeping until: %s", m_index, ss.str().c_str());
+        }
+    }
+    else {
+        LOG(LOG_DEBUG, "Shard %zu has no events, sleeping until changes", m_index);
+    }
+
+    if (next == m_armedTime)
+        return;
+    m_armedTime = next;
+
+    // wall clock changes cancel the timer so deadlines are recomputed
+    if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) == -1)
+        LOG(LOG_ERR, "timerfd_settime(2) call error: %s", strerror(errno));
+}
+
+void Shard::insert(const TextEvent& event) {
+    erase(event.event.key);
+    Event stored{ event.event };
+    stored.text = m_pool.intern(event.text);
+    m_keys[stored.key] = m_events->push(stored);
+}
+
+bool Shard::erase(std::uint64_t key) {
+    auto it = m_keys.find(key);
+    if (it == m_keys.end())
+        return false;
+    m_pool.release(m_events->get(it->second).text);
+    m_events->remove(it->second);
+    m_keys.erase(it);
+    return true;
+}
+
+void Shard::compact() {
+    LOG(LOG_DEBUG, "Shard %zu compacting texts, %zu live and %zu dead bytes",
+        m_index, m_pool.liveBytes(), m_pool.deadBytes());
+    // the old arena is freed in bulk when it goes out of scope
+    StringPool pool;
+    for (auto& key : m_keys) {
+        Event& event = m_events->get(key.second);
+        event.text = pool.intern(m_pool.get(event.text));
+    }
+    std::swap(m_pool, pool);
+}
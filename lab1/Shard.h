@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Clock.h"
+#include "Dispatcher.h"
+#include "Scheduler.h"
+#include "Snapshot.h"
+#include "StringPool.h"
+
+// part of the schedule fired by its own thread
+// events are keyed by Event::key, other threads change them under the shard lock
+class Shard {
+  public:
+    // what to do with occurrences of a repeating event missed during a stall or suspend
+    enum class MissedPolicy {
+        ONCE,   // fire once for all of them
+        ALL,    // fire each of them
+        SKIP    // fire none of them
+    };
+
+    // takes ownership of events, without dispatcher fired events are only counted
+    Shard(std::size_t index, Scheduler* events, Dispatcher* dispatcher, MissedPolicy missed,
+          const Clock* clock = &Clock::system());
+    ~Shard();
+
+    bool start();   // create timerfd and start firing thread
+    void stop();    // join firing thread
+
+    // remove events by keys and add new ones under one lock,
+    // rebuilds the string pool when most of it is garbage
+    void update(const std::vector<std::uint64_t>& removed, const std::vector<TextEvent>& added);
+    void add(const TextEvent& event);   // replaces event with the same key
+    bool remove(std::uint64_t key);
+
+    // copy events for snapshot, texts point into the pool and stay valid until the next update
+    void collect(std::vector<Snapshot::Entry>* entries) const;
+    std::size_t size() const;
+
+    // fire events due at clock time without the firing thread, returns fired count
+    std::uint64_t tick();
+    bool next(Scheduler::TimePoint* time) const;    // earliest deadline, false if there are no events
+
+  private:
+    // pools with less garbage aren't worth rebuilding
+    static constexpr std::size_t MIN_GARBAGE{ 1024 * 1024 };
+
+    std::size_t m_index{};  // shard number for logs
+    Dispatcher* m_dispatcher{};
+    MissedPolicy m_missed{};
+    const Clock* m_clock{};
+
+    mutable std::mutex m_mutex{};   // guards everything below
+    std::unique_ptr<Scheduler> m_events{};
+    std::unordered_map<std::uint64_t, Scheduler::Id> m_keys{};  // event key to scheduler id
+    StringPool m_pool{};    // event texts
+    int m_timerFd{ -1 };    // armed at the next event time
+    Scheduler::TimePoint m_armedTime{ Scheduler::TimePoint::max() };  // max if disarmed
+
+    std::atomic<bool> m_isStopped{};
+    std::thread m_thread{};
+
+    void loop();    // firing thread body
+    std::uint64_t fire();   // dispatch due events, caller holds m_mutex
+    void armTimer();    // arm timerfd at the next event time if started, caller holds m_mutex
+    void insert(const TextEvent& event);    // caller holds m_mutex
+    bool erase(std::uint64_t key);  // caller holds m_mutex
+    void compact(); // move live texts into a fresh pool, caller holds m_mutex
+};
@@ -0,0 +1,174 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "Hash.h"
+#include "Logger.h"
+#include "Snapshot.h"
+
+constexpr char Snapshot::MAGIC[8];
+
+bool Snapshot::configInfo(const std::string& path, ConfigInfo* info) {
+    struct stat st;
+    if (stat(path.c_str(), &st) == -1)
+        return false;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::string content{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    info->mtime = st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+    info->size = content.size();
+    info->hash = hashBytes(content);
+    return true;
+}
+
+bool Snapshot::save(const std::string& path, const ConfigInfo& config, const std::vector<Entry>& entries) {
+    // not world-writable, snapshot events are trusted on restart
+    std::string tmpPath{ path + ".tmp" };
+    int fd{ open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600) };
+    if (fd == -1) {
+        LOG(LOG_ERR, "open(2) call error for snapshot: %s", strerror(errno));
+        return false;
+    }
+
+    bool isWritten{ write(fd, config, entries) };
+    close(fd);
+    if (!isWritten) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    if (rename(tmpPath.c_str(), path.c_str()) == -1) {
+        LOG(LOG_ERR, "rename(2) call error: %s", strerror(errno));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::write(int fd, const ConfigInfo& config, const std::vector<Entry>& entries) {
+    std::vector<Record> records;
+    records.reserve(entries.size());
+    std::string strings;
+    // equal texts are stored once, like in the shard string pools
+    std::unordered_map<std::string_view, std::uint32_t> offsets;
+
+    for (const Entry& entry : entries) {
+        Record record{};
+        record.key = entry.key;
+        if (entry.hasEvent) {
+            const Event& event = entry.event;
+            record.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                event.time.time_since_epoch()).count();
+            record.repeat = event.repeat.count();
+            record.rule = event.rule;
+            record.flags = HAS_EVENT;
+            auto it = offsets.find(entry.text);
+            if (it == offsets.end()) {
+                it = offsets.emplace(entry.text, strings.size()).first;
+                strings += entry.text;
+            }
+            record.textOffset = it->second;
+            record.textLength = entry.text.size();
+        }
+        records.push_back(record);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.config = config;
+    header.recordCnt = records.size();
+    header.stringsSize = strings.size();
+
+    iovec iov[]{
+        { &header, sizeof(header) },
+        { records.data(), records.size() * sizeof(Record) },
+        { &strings[0], strings.size() }
+    };
+    std::size_t total{ iov[0].iov_len + iov[1].iov_len + iov[2].iov_len };
+    ssize_t written{ writev(fd, iov, 3) };
+    if (written < 0 || static_cast<std::size_t>(written) != total) {
+        LOG(LOG_ERR, "writev(2) call error for snapshot: %s", written < 0 ? strerror(errno) : "short write");
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::load(const std::string& path, const ConfigInfo& config, const EntryHandler& handler) {
+    int fd{ open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+    if (fd == -1) {
+        LOG(LOG_INFO, "No snapshot file %s", path.c_str());
+        return false;
+    }
+
+    bool isRead{ read(fd, config, handler) };
+    close(fd);
+    return isRead;
+}
+
+bool Snapshot::read(int fd, const ConfigInfo& config, const EntryHandler& handler) {
+    struct stat st;
+    if (fstat(fd, &st) == -1 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+        LOG(LOG_WARNING, "Snapshot file is too small");
+        return false;
+    }
+    std::size_t size = st.st_size;
+
+    void* data{ mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) };
+    if (data == MAP_FAILED) {
+        LOG(LOG_ERR, "mmap(2) call error: %s", strerror(errno));
+        return false;
+    }
+
+    const char* base{ static_cast<const char*>(data) };
+    const Header* header{ reinterpret_cast<const Header*>(base) };
+    const Record* records{ reinterpret_cast<const Record*>(base + sizeof(Header)) };
+    const char* strings{ base + sizeof(Header) };
+
+    bool isValid{ std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION };
+    if (isValid && !(header->config == config)) {
+        LOG(LOG_INFO, "Snapshot is stale");
+        isValid = false;
+    }
+    if (isValid && (header->recordCnt > (size - sizeof(Header)) / sizeof(Record)
+                    || header->stringsSize != size - sizeof(Header) - header->recordCnt * sizeof(Record))) {
+        LOG(LOG_WARNING, "Snapshot file is corrupt");
+        isValid = false;
+    }
+
+    if (isValid) {
+        strings += header->recordCnt * sizeof(Record);
+        for (std::uint64_t i{}; i < header->recordCnt; ++i) {
+            const Record& record = records[i];
+            if (!(record.flags & HAS_EVENT)
+                || std::uint64_t(record.textOffset) + record.textLength > header->stringsSize) {
+                handler(record.key, nullptr);
+                continue;
+            }
+
+            TextEvent textEvent;
+            Event& event = textEvent.event;
+            event.time = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(record.time)));
+            event.repeat = std::chrono::seconds(record.repeat);
+            event.rule = record.rule;
+            event.key = record.key;
+            textEvent.text = std::string_view(strings + record.textOffset, record.textLength);
+            handler(record.key, &textEvent);
+        }
+    }
+
+    munmap(data, size);
+    return isValid;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Event.h"
+
+// binary snapshot of scheduled events for fast restart
+// layout: header, fixed-size records, string table with event texts
+// snapshot is valid only for the config file state it was taken from
+class Snapshot {
+  public:
+    // config file state the snapshot is validated against
+    struct ConfigInfo {
+        std::int64_t mtime{};   // modification time, ns
+        std::uint64_t size{};   // size in bytes
+        std::uint64_t hash{};   // content hash
+
+        bool operator==(const ConfigInfo& other) const {
+            return mtime == other.mtime && size == other.size && hash == other.hash;
+        }
+    };
+
+    // config line with its pending event
+    struct Entry {
+        std::uint64_t key{};    // config line key
+        bool hasEvent{};    // false for lines without pending event
+        Event event{};
+        std::string_view text{};    // event text, must outlive the save call
+    };
+
+    // called for every entry read, event is nullptr for lines without pending event
+    // event text points into the mapped snapshot and is valid only during the call
+    using EntryHandler = std::function<void(std::uint64_t key, TextEvent* event)>;
+
+    static bool configInfo(const std::string& path, ConfigInfo* info);
+
+    // write entries atomically (via temporary file and rename)
+    static bool save(const std::string& path, const ConfigInfo& config, const std::vector<Entry>& entries);
+    // map snapshot and pass its entries to handler, false if missing, corrupt or stale
+    static bool load(const std::string& path, const ConfigInfo& config, const EntryHandler& handler);
+
+    // same for an open file positioned at its start
+    static bool write(int fd, const ConfigInfo& config, const std::vector<Entry>& entries);
+    static bool read(int fd, const ConfigInfo& config, const EntryHandler& handler);
+
+  private:
+    static constexpr char MAGIC[8]{ 'R', 'E', 'M', 'S', 'N', 'A', 'P', '\0' };
+    static constexpr std::uint32_t VERSION{ 2 };
+    static constexpr std::uint32_t HAS_EVENT{ 1 };  // record flag
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t reserved;
+        ConfigInfo config;
+        std::uint64_t recordCnt;
+        std::uint64_t stringsSize;
+    };
+
+    struct Record {
+        std::int64_t time;  // event time, ns since epoch
+        std::int32_t repeat;    // repetition time, s
+        std::uint32_t flags;
+        std::uint64_t key;  // config line key
+        std::uint32_t textOffset;   // text position in string table
+        std::uint32_t textLength;
+        CronRule rule;  // recurrence rule, empty for fixed repetition time
+    };
+    static_assert(sizeof(Record) == 56, "snapshot record must be packed");
+};
@@ -0,0 +1,49 @@
+#include <cstring>
+
+#include "StringPool.h"
+
+StringPool::Handle StringPool::intern(std::string_view str) {
+    auto it = m_index.find(str);
+    if (it != m_index.end()) {
+        String& string = m_strings[it->second];
+        if (!string.refs++) {
+            m_deadBytes -= str.size();
+            m_liveBytes += str.size();
+        }
+        return it->second;
+    }
+
+    Handle handle = m_strings.size();
+    std::string_view stored{ copy(str), str.size() };
+    m_strings.push_back({ stored, 1 });
+    m_index.emplace(stored, handle);
+    m_liveBytes += str.size();
+    return handle;
+}
+
+void StringPool::release(Handle handle) {
+    String& string = m_strings[handle];
+    if (!--string.refs) {
+        m_liveBytes -= string.str.size();
+        m_deadBytes += string.str.size();
+    }
+}
+
+const char* StringPool::copy(std::string_view str) {
+    // long strings get their own block, so filling blocks aren't abandoned half empty
+    if (str.size() > BLOCK_SIZE / 4) {
+        m_blocks.emplace_back(new char[str.size()]);
+        std::memcpy(m_blocks.back().get(), str.data(), str.size());
+        return m_blocks.back().get();
+    }
+
+    if (!m_block || m_blockUsed + str.size() > BLOCK_SIZE) {
+        m_blocks.emplace_back(new char[BLOCK_SIZE]);
+        m_block = m_blocks.back().get();
+        m_blockUsed = 0;
+    }
+    char* ptr{ m_block + m_blockUsed };
+    std::memcpy(ptr, str.data(), str.size());
+    m_blockUsed += str.size();
+    return ptr;
+}
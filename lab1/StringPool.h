@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// arena of interned strings referenced by compact handles
+// equal strings share one copy, strings are never moved or freed one by one,
+// the owner rebuilds the pool from live strings when garbage dominates
+class StringPool {
+  public:
+    using Handle = std::uint32_t;
+
+    Handle intern(std::string_view str);    // find or copy string, adds a reference
+    void release(Handle handle);    // drops a reference, memory is kept until pool is rebuilt
+    std::string_view get(Handle handle) const { return m_strings[handle].str; }
+
+    std::size_t size() const { return m_strings.size(); }  // distinct strings
+    std::size_t liveBytes() const { return m_liveBytes; }  // bytes of referenced strings
+    std::size_t deadBytes() const { return m_deadBytes; }  // bytes of unreferenced strings
+
+  private:
+    static constexpr std::size_t BLOCK_SIZE{ 64 * 1024 };
+
+    struct String {
+        std::string_view str{};   // points into a block
+        std::uint32_t refs{};
+    };
+
+    std::vector<std::unique_ptr<char[]>> m_blocks{};
+    char* m_block{};    // block being filled
+    std::size_t m_blockUsed{};  // bytes taken in m_block
+    std::vector<String> m_strings{};    // indexed by handle
+    std::unordered_map<std::string_view, Handle> m_index{};
+    std::size_t m_liveBytes{};
+    std::size_t m_deadBytes{};
+
+    const char* copy(std::string_view str); // place string into arena
+};
@@ -0,0 +1,260 @@
+#include <algorithm>
+
+#include "TimingWheel.h"
+
+namespace {
+
+// seconds since epoch rounded up, so the event never fires early
+std::int64_t toSeconds(Scheduler::TimePoint time) {
+    auto since = time.time_since_epoch();
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since);
+    if (seconds < since)
+        ++seconds;
+    return seconds.count();
+}
+
+// seconds since epoch rounded down
+std::int64_t floorSeconds(Scheduler::TimePoint time) {
+    auto since = time.time_since_epoch();
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since);
+    if (seconds > since)
+        --seconds;
+    return seconds.count();
+}
+
+constexpr std::int64_t MINUTE{ 60 };
+constexpr std::int64_t HOUR{ 60 * MINUTE };
+constexpr std::int64_t DAY{ 24 * HOUR };
+
+}
+
+TimingWheel::TimingWheel() {
+    m_heads.fill(NONE);
+}
+
+Scheduler::Id TimingWheel::push(Event event) {
+    if (m_now < 0)
+        m_now = floorSeconds(std::chrono::system_clock::now());
+
+    Id id{};
+    if (m_free.empty()) {
+        id = m_slots.size();
+        m_slots.emplace_back();
+    }
+    else {
+        id = m_free.back();
+        m_free.pop_back();
+    }
+
+    Slot& slot = m_slots[id];
+    slot.expire = toSeconds(event.time);
+    slot.event = std::move(event);
+    ++m_size;
+
+    insert(id);
+    return id;
+}
+
+bool TimingWheel::remove(Id id) {
+    if (id >= m_slots.size() || m_slots[id].bucket < 0)
+        return false;
+
+    unlink(id);
+    m_slots[id].event = {};
+    m_free.push_back(id);
+    --m_size;
+    return true;
+}
+
+void TimingWheel::reschedule(Id id, TimePoint time) {
+    Slot& slot = m_slots[id];
+    unlink(id);
+    slot.event.time = time;
+    slot.expire = toSeconds(time);
+    insert(id);
+}
+
+bool TimingWheel::poll(TimePoint now, Id* id) {
+    if (m_size == 0)
+        return false;
+
+    advance(floorSeconds(now));
+    Id head{ m_heads[READY_BUCKET] };
+    if (head == NONE)
+        return false;
+    *id = head;
+    return true;
+}
+
+bool TimingWheel::next(TimePoint* time) const {
+    if (m_size == 0)
+        return false;
+
+    auto toTime = [](std::int64_t seconds) {
+        return TimePoint(std::chrono::seconds(seconds));
+    };
+
+    if (m_heads[READY_BUCKET] != NONE) {
+        *time = toTime(m_now);
+        return true;
+    }
+
+    // the first non-empty bucket after now on the lowest non-empty level
+    if (m_levelSizes[0]) {
+        for (std::int64_t t{ m_now + 1 }; ; ++t)
+            if (m_heads[t % SECONDS] != NONE) {
+                *time = toTime(t);
+                return true;
+            }
+    }
+    if (m_levelSizes[1]) {
+        for (std::int64_t m{ m_now / MINUTE + 1 }; ; ++m)
+            if (m_heads[MINUTES_BASE + m % MINUTES] != NONE) {
+                *time = toTime(m * MINUTE);
+                return true;
+            }
+    }
+    if (m_levelSizes[2]) {
+        for (std::int64_t h{ m_now / HOUR + 1 }; ; ++h)
+            if (m_heads[HOURS_BASE + h % HOURS] != NONE) {
+                *time = toTime(h * HOUR);
+                return true;
+            }
+    }
+    if (m_levelSizes[3]) {
+        for (std::int64_t d{ m_now / DAY + 1 }; ; ++d)
+            if (m_heads[DAYS_BASE + d % DAYS] != NONE) {
+                *time = toTime(d * DAY);
+                return true;
+            }
+    }
+
+    // overflow is redistributed when the day level wraps
+    *time = toTime((m_now / DAY / DAYS + 1) * DAYS * DAY);
+    return true;
+}
+
+Event& TimingWheel::get(Id id) {
+    return m_slots[id].event;
+}
+
+const Event& TimingWheel::get(Id id) const {
+    return m_slots[id].event;
+}
+
+std::size_t TimingWheel::size() const {
+    return m_size;
+}
+
+void TimingWheel::clear() {
+    m_slots.clear();
+    m_free.clear();
+    m_heads.fill(NONE);
+    m_levelSizes.fill(0);
+    m_size = 0;
+    m_now = -1;
+}
+
+void TimingWheel::insert(Id id) {
+    std::int64_t expire{ m_slots[id].expire };
+
+    if (expire <= m_now)
+        link(id, READY_BUCKET);
+    else if (expire / MINUTE == m_now / MINUTE)
+        link(id, expire % SECONDS);
+    else if (expire / HOUR == m_now / HOUR)
+        link(id, MINUTES_BASE + expire / MINUTE % MINUTES);
+    else if (expire / DAY == m_now / DAY)
+        link(id, HOURS_BASE + expire / HOUR % HOURS);
+    else if (expire / DAY - m_now / DAY < DAYS)
+        link(id, DAYS_BASE + expire / DAY % DAYS);
+    else
+        link(id, OVERFLOW_BUCKET);
+}
+
+void TimingWheel::link(Id id, int bucket) {
+    Slot& slot = m_slots[id];
+    slot.bucket = bucket;
+    slot.prev = NONE;
+    slot.next = m_heads[bucket];
+    if (slot.next != NONE)
+        m_slots[slot.next].prev = id;
+    m_heads[bucket] = id;
+
+    int l{ level(bucket) };
+    if (l >= 0)
+        ++m_levelSizes[l];
+}
+
+void TimingWheel::unlink(Id id) {
+    Slot& slot = m_slots[id];
+    if (slot.prev != NONE)
+        m_slots[slot.prev].next = slot.next;
+    else
+        m_heads[slot.bucket] = slot.next;
+    if (slot.next != NONE)
+        m_slots[slot.next].prev = slot.prev;
+
+    int l{ level(slot.bucket) };
+    if (l >= 0)
+        --m_levelSizes[l];
+    slot.bucket = -1;
+}
+
+void TimingWheel::cascade(int bucket) {
+    Id id{ m_heads[bucket] };
+    while (id != NONE) {
+        Id next{ m_slots[id].next };
+        unlink(id);
+        insert(id);
+        id = next;
+    }
+}
+
+void TimingWheel::advance(std::int64_t now) {
+    while (m_now < now) {
+        // jump over spans where lower levels have nothing to fire
+        std::int64_t step{ 1 };
+        if (!m_levelSizes[0]) {
+            step = MINUTE - m_now % MINUTE;
+            if (!m_levelSizes[1]) {
+                step = HOUR - m_now % HOUR;
+                if (!m_levelSizes[2]) {
+                    step = DAY - m_now % DAY;
+                    if (!m_levelSizes[3])
+                        step = DAYS * DAY - m_now % (DAYS * DAY);
+                }
+            }
+        }
+        m_now = std::min(m_now + step, now);
+
+        if (m_now % (DAYS * DAY) == 0)
+            cascade(OVERFLOW_BUCKET);
+        if (m_now % DAY == 0)
+            cascade(DAYS_BASE + m_now / DAY % DAYS);
+        if (m_now % HOUR == 0)
+            cascade(HOURS_BASE + m_now / HOUR % HOURS);
+        if (m_now % MINUTE == 0)
+            cascade(MINUTES_BASE + m_now / MINUTE % MINUTES);
+
+        Id id{ m_heads[m_now % SECONDS] };
+        while (id != NONE) {
+            Id next{ m_slots[id].next };
+            unlink(id);
+            link(id, READY_BUCKET);
+            id = next;
+        }
+    }
+}
+
+int TimingWheel::level(int bucket) const {
+    if (bucket < MINUTES_BASE)
+        return 0;
+    if (bucket < HOURS_BASE)
+        return 1;
+    if (bucket < DAYS_BASE)
+        return 2;
+    if (bucket < OVERFLOW_BUCKET)
+        return 3;
+    return -1;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Scheduler.h"
+
+// hierarchical timing wheel with second, minute, hour and day levels
+// events are kept in intrusive lists, so push, remove and reschedule are O(1)
+// events farther than DAYS days ahead wait in an overflow list
+// that is redistributed each time the day level wraps
+class TimingWheel : public Scheduler {
+    static constexpr int SECONDS{ 60 };
+    static constexpr int MINUTES{ 60 };
+    static constexpr int HOURS{ 24 };
+    static constexpr int DAYS{ 64 };
+
+    // bucket layout: level slots, then overflow and ready lists
+    static constexpr int MINUTES_BASE{ SECONDS };
+    static constexpr int HOURS_BASE{ MINUTES_BASE + MINUTES };
+    static constexpr int DAYS_BASE{ HOURS_BASE + HOURS };
+    static constexpr int OVERFLOW_BUCKET{ DAYS_BASE + DAYS };
+    static constexpr int READY_BUCKET{ OVERFLOW_BUCKET + 1 };
+    static constexpr int BUCKETS{ READY_BUCKET + 1 };
+
+  public:
+    TimingWheel();
+
+    Id push(Event event) override;  // O(1)
+    bool remove(Id id) override;    // O(1)
+    void reschedule(Id id, TimePoint time) override;   // O(1)
+
+    bool poll(TimePoint now, Id* id) override;  // amortized O(1) per elapsed bucket
+    bool next(TimePoint* time) const override;  // O(buckets), bucket start for upper levels
+
+    Event& get(Id id) override;
+    const Event& get(Id id) const override;
+
+    std::size_t size() const override;
+    void clear() override;
+
+  private:
+    struct Slot {
+        Event event{};
+        std::int64_t expire{};  // event time rounded up to seconds
+        Id prev{ NONE };
+        Id next{ NONE };
+        int bucket{ -1 };   // -1 for free slots
+    };
+
+    std::vector<Slot> m_slots{};  // event storage indexed by id
+    std::vector<Id> m_free{};     // ids of removed events for reuse
+    std::array<Id, BUCKETS> m_heads{};  // first event of each bucket
+    std::array<std::size_t, 4> m_levelSizes{};  // events per level to skip empty spans
+    std::size_t m_size{};
+    std::int64_t m_now{ -1 };   // all events expiring at or before it are ready
+
+    void insert(Id id); // put event to bucket by its expiration time
+    void link(Id id, int bucket);
+    void unlink(Id id);
+    void cascade(int bucket);   // redistribute bucket to lower levels
+    void advance(std::int64_t now); // process seconds up to now
+    int level(int bucket) const;
+};
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "ConfigParser.h"
+#include "Scheduler.h"
+#include "StringPool.h"
+
+using Clock = std::chrono::steady_clock;
+using TimePoint = std::chrono::system_clock::time_point;
+
+// random events spread over a week with a mix of repeat intervals
+std::vector<Event> getEvents(std::size_t n, TimePoint start, std::default_random_engine& rng) {
+    const std::chrono::seconds repeats[]{
+        std::chrono::seconds(0),
+        std::chrono::seconds(60),
+        std::chrono::seconds(60 * 60),
+        std::chrono::seconds(24 * 60 * 60),
+        std::chrono::seconds(7 * 24 * 60 * 60)
+    };
+    std::uniform_int_distribution<int> offset(0, 7 * 24 * 60 * 60);
+    std::uniform_int_distribution<int> repeat(0, 4);
+
+    std::vector<Event> events;
+    events.reserve(n);
+    for (std::size_t i{}; i < n; ++i)
+        events.push_back({ start + std::chrono::seconds(offset(rng)), repeats[repeat(rng)], i, 0 });
+    return events;
+}
+
+// config file with a line for each event
+std::string writeConfig(const std::vector<Event>& events) {
+    static const char* FLAGS[]{ "", "-m ", "-h ", "-d ", "-w " };
+
+    std::string path{ "/tmp/reminder_bench_" + std::to_string(getpid()) + ".conf" };
+    std::ofstream file(path);
+    for (const Event& e : events) {
+        std::time_t tt = std::chrono::system_clock::to_time_t(e.time);
+        std::tm tm = *std::localtime(&tt);
+        int flag{ e.repeat.count() == 60 ? 1 : e.repeat.count() == 60 * 60 ? 2
+            : e.repeat.count() == 24 * 60 * 60 ? 3 : e.repeat.count() ? 4 : 0 };
+        file << "add_event " << std::put_time(&tm, "%d/%m/%Y %T") << " " << FLAGS[flag] << "event" << "\n";
+    }
+    return path;
+}
+
+// parse config with ConfigParser, returns number of events
+std::size_t loadParser(const std::string& path) {
+    ConfigParser parser;
+    StringPool pool;
+    std::vector<Event> events;
+    std::ifstream file(path);
+    std::string str;
+    while (std::getline(file, str)) {
+        ConfigParser::Line line;
+        if (parser.parse(str, &line) == ConfigParser::Status::OK)
+            events.push_back({ line.time, line.repeat, events.size(), pool.intern(line.text) });
+    }
+    return events.size();
+}
+
+// parse config with regex and get_time, as the daemon used to do
+std::size_t loadRegex(const std::string& path) {
+    const std::regex EVENT_REGEX{
+        R"(^\s*add_event\s+(\S+\s+\S+)\s+(-m|-h|-d|-w)*\s*(.+)\s*)"
+    };
+
+    std::vector<Event> events;
+    std::vector<std::string> texts;
+    std::ifstream file(path);
+    std::string str;
+    while (std::getline(file, str)) {
+        if (!std::regex_match(str, EVENT_REGEX))
+            continue;
+        std::smatch match;
+        std::regex_search(str, match, EVENT_REGEX);
+        std::tm tm{};
+        if ((std::istringstream(match[1]) >> std::get_time(&tm, "%d/%m/%Y %T")).fail())
+            continue;
+        tm.tm_isdst = -1;
+        events.push_back({ std::chrono::system_clock::from_time_t(std::mktime(&tm)), {}, events.size(), 0 });
+        texts.push_back(match[3]);
+    }
+    return events.size();
+}
+
+// tick over a scheduler: fire due events and find next deadline
+std::size_t tickScheduler(Scheduler& events, TimePoint now, TimePoint* next) {
+    std::size_t fired{};
+    Scheduler::Id id{};
+    while (events.poll(now, &id)) {
+        Event& e = events.get(id);
+        ++fired;
+        if (e.repeat != std::chrono::seconds(0))
+            events.reschedule(id, e.time + e.repeat);
+        else
+            events.remove(id);
+    }
+
+    TimePoint time;
+    if (events.next(&time))
+        *next = std::min(*next, time);
+    return fired;
+}
+
+// tick over a vector with a full scan, as the daemon used to do
+std::size_t tickScan(std::vector<Event>& events, TimePoint now, TimePoint* next) {
+    std::size_t fired{};
+    for (auto e = events.begin(); e != events.end(); ++e) {
+        if (now < e->time) {
+            *next = std::min(*next, e->time);
+            continue;
+        }
+
+        ++fired;
+        if (e->repeat != std::chrono::seconds(0))
+            e->time += e->repeat;
+        else
+            events.erase(e--);
+    }
+    return fired;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t eventsCnt{ argc > 1 ? std::stoul(argv[1]) : 1000000 };
+    std::size_t ticksCnt{ argc > 2 ? std::stoul(argv[2]) : 1000 };
+
+    std::default_random_engine rng{ 42 };
+    TimePoint start{ std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()) };
+    std::vector<Event> events{ getEvents(eventsCnt, start, rng) };
+
+    std::cout << "Events: " << eventsCnt << ", ticks: " << ticksCnt << std::endl;
+
+    for (const char* type : { "heap", "wheel" }) {
+        std::unique_ptr<Scheduler> scheduler{ Scheduler::create(type) };
+        auto t0 = Clock::now();
+        for (const Event& e : events)
+            scheduler->push(e);
+        auto t1 = Clock::now();
+
+        std::size_t fired{};
+        for (std::size_t i{}; i < ticksCnt; ++i) {
+            TimePoint now{ start + std::chrono::seconds(i) };
+            TimePoint next{ now + std::chrono::seconds(10) };
+            fired += tickScheduler(*scheduler, now, &next);
+        }
+        auto t2 = Clock::now();
+
+        std::cout << type << ": build " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, "
+                  << "tick " << std::chrono::duration<double, std::micro>(t2 - t1).count() / ticksCnt << " us, "
+                  << "fired " << fired << std::endl;
+    }
+
+    {
+        std::vector<Event> scan{ events };
+        auto t0 = Clock::now();
+
+        std::size_t fired{};
+        for (std::size_t i{}; i < ticksCnt; ++i) {
+            TimePoint now{ start + std::chrono::seconds(i) };
+            TimePoint next{ now + std::chrono::seconds(10) };
+            fired += tickScan(scan, now, &next);
+        }
+        auto t1 = Clock::now();
+
+        std::cout << "scan: tick " << std::chrono::duration<double, std::micro>(t1 - t0).count() / ticksCnt << " us, "
+                  << "fired " << fired << std::endl;
+    }
+
+    {
+        std::string path{ writeConfig(events) };
+
+        auto t0 = Clock::now();
+        std::size_t parsed{ loadParser(path) };
+        auto t1 = Clock::now();
+        std::size_t matched{ loadRegex(path) };
+        auto t2 = Clock::now();
+
+        std::cout << "load parser: " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, "
+                  << "events " << parsed << std::endl;
+        std::cout << "load regex: " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms, "
+                  << "events " << matched << std::endl;
+        unlink(path.c_str());
+    }
+
+    return EXIT_SUCCESS;
+}
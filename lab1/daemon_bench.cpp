@@ -0,0 +1,295 @@
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "Metrics.h"
+#include "Reminder.h"
+
+using SteadyClock = std::chrono::steady_clock;
+using TimePoint = std::chrono::system_clock::time_point;
+
+// synthetic config settings
+struct ConfigSpec {
+    std::size_t events{ 100000 };   // config lines
+    // relative weights of no repeat, -m, -h, -d and -w lines
+    std::vector<unsigned> repeatMix{ 1, 1, 1, 1, 1 };
+    std::size_t texts{ 1000 };  // distinct event texts
+    std::chrono::seconds spread{ 10 };  // first event times are within spread after start
+    std::size_t files{};    // files of config directory, zero for a single config file
+};
+
+// benchmark run settings
+struct BenchSpec {
+    ConfigSpec config{};
+    std::string scheduler{ "heap" };
+    std::size_t shards{ 1 };
+    std::size_t reloads{ 3 };   // config rewrites during the run
+    unsigned changed{ 10 }; // percent of lines replaced by every rewrite
+    std::chrono::seconds duration{ 10 };    // time to let events fire
+};
+
+// events start this late after config generation, so none of them passes during the initial load
+constexpr std::chrono::seconds LEAD{ 2 };
+
+// generates config lines with random times and repeat flags
+class ConfigGenerator {
+  public:
+    ConfigGenerator(const ConfigSpec& spec, TimePoint start)
+        : m_spec(spec), m_start(start), m_repeat(spec.repeatMix.begin(), spec.repeatMix.end()),
+          m_offset(LEAD.count(), LEAD.count() + std::max<long>(spec.spread.count(), 1)), m_text(0, spec.texts ? spec.texts - 1 : 0) {}
+
+    std::string line() {
+        static const char* FLAGS[]{ "", "-m ", "-h ", "-d ", "-w " };
+
+        std::time_t tt = std::chrono::system_clock::to_time_t(m_start + std::chrono::seconds(m_offset(m_rng)));
+        std::tm tm;
+        localtime_r(&tt, &tm);
+        char time[32];
+        std::strftime(time, sizeof(time), "%d/%m/%Y %H:%M:%S", &tm);
+        return std::string("add_event ") + time + ' ' + FLAGS[m_repeat(m_rng)] + "event " + std::to_string(m_text(m_rng));
+    }
+
+    std::vector<std::string> lines() {
+        std::vector<std::string> lines;
+        lines.reserve(m_spec.events);
+        for (std::size_t i{}; i < m_spec.events; ++i)
+            lines.push_back(line());
+        return lines;
+    }
+
+  private:
+    ConfigSpec m_spec;
+    TimePoint m_start;
+    std::default_random_engine m_rng{ 42 };
+    std::discrete_distribution<int> m_repeat;
+    std::uniform_int_distribution<long> m_offset;
+    std::uniform_int_distribution<std::size_t> m_text;
+};
+
+// replace config atomically, so inotify reports a single complete write
+bool writeConfig(const std::string& path, const std::vector<std::string>& lines) {
+    std::string tmpPath{ path + ".tmp" };
+    FILE* file{ std::fopen(tmpPath.c_str(), "w") };
+    if (!file)
+        return false;
+    for (const std::string& line : lines) {
+        std::fputs(line.c_str(), file);
+        std::fputc('\n', file);
+    }
+    bool isWritten{ std::fclose(file) == 0 };
+    return isWritten && std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+// single config file, or lines dealt round-robin into files of config directory,
+// dirty marks the files to rewrite, all of them if it is nullptr
+bool writeConfigs(const std::string& path, const std::vector<std::string>& lines, std::size_t files,
+                  const std::vector<char>* dirty = nullptr) {
+    if (!files)
+        return writeConfig(path, lines);
+
+    if (mkdir(path.c_str(), 0755) == -1 && errno != EEXIST)
+        return false;
+    for (std::size_t i{}; i < files; ++i) {
+        if (dirty && !(*dirty)[i])
+            continue;
+        std::vector<std::string> part;
+        for (std::size_t j{ i }; j < lines.size(); j += files)
+            part.push_back(lines[j]);
+        if (!writeConfig(path + "/user" + std::to_string(i), part))
+            return false;
+    }
+    return true;
+}
+
+void removeConfigs(const std::string& path, std::size_t files) {
+    for (std::size_t i{}; i < files; ++i)
+        unlink((path + "/user" + std::to_string(i)).c_str());
+    if (files)
+        rmdir(path.c_str());
+    else
+        unlink(path.c_str());
+}
+
+// weights from "none,m,h,d,w" list
+std::vector<unsigned> parseMix(const std::string& str) {
+    std::vector<unsigned> mix;
+    std::istringstream ss(str);
+    std::string weight;
+    while (std::getline(ss, weight, ','))
+        mix.push_back(std::stoul(weight));
+    if (mix.size() != 5)
+        throw std::invalid_argument(str);
+    return mix;
+}
+
+// json object with histogram summary
+std::string toJson(const Histogram::Summary& summary) {
+    return "{\"count\":" + std::to_string(summary.count)
+        + ",\"mean\":" + std::to_string(summary.count ? summary.sum / summary.count : 0)
+        + ",\"p50\":" + std::to_string(summary.p50)
+        + ",\"p90\":" + std::to_string(summary.p90)
+        + ",\"p99\":" + std::to_string(summary.p99)
+        + ",\"max\":" + std::to_string(summary.max) + "}";
+}
+
+// wait until config loads recorded exceed count, false on timeout
+bool waitLoads(std::uint64_t count) {
+    auto deadline = SteadyClock::now() + std::chrono::seconds(60);
+    while (Metrics::getInstance().configLoad.summary().count <= count) {
+        if (SteadyClock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+int run(const BenchSpec& spec) {
+    std::string path{ "/tmp/reminder_daemon_bench_" + std::to_string(getpid()) + (spec.config.files ? "" : ".conf") };
+    TimePoint start{ std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()) };
+    ConfigGenerator generator(spec.config, start);
+    std::vector<std::string> lines{ generator.lines() };
+    if (!writeConfigs(path, lines, spec.config.files)) {
+        std::cerr << "Config write error: " << path << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // daemon code runs in process, nothing outside the config file is touched
+    Reminder::Options options;
+    options.configPath = path;
+    options.daemonize = false;
+    options.pidPath.clear();
+    options.controlPath.clear();
+    options.snapshotPath.clear();
+    options.scheduler = spec.scheduler;
+    options.shards = spec.shards;
+    options.notifier.clear();
+    options.logLevel = LOG_WARNING;
+    Logger::setLevel(options.logLevel);
+
+    Metrics& metrics{ Metrics::getInstance() };
+    Reminder& reminder{ Reminder::getInstance() };
+    reminder.init(options);
+    Histogram::Summary load{ metrics.configLoad.summary() };
+    std::thread daemon(&Reminder::run, &reminder);
+
+    // rewrites are spread over the run, each replaces random lines with new events
+    std::default_random_engine rng{ 7 };
+    std::uniform_int_distribution<std::size_t> index(0, lines.empty() ? 0 : lines.size() - 1);
+    auto begin = SteadyClock::now();
+    bool isReloaded{ true };
+    for (std::size_t i{}; i < spec.reloads && isReloaded; ++i) {
+        std::this_thread::sleep_until(begin + spec.duration * (i + 1) / (spec.reloads + 1));
+        std::vector<char> dirty(spec.config.files);
+        for (std::size_t j{}; j < lines.size() * spec.changed / 100; ++j) {
+            std::size_t k{ index(rng) };
+            lines[k] = generator.line();
+            if (spec.config.files)
+                dirty[k % spec.config.files] = true;
+        }
+        std::uint64_t loads{ metrics.configLoad.summary().count };
+        isReloaded = writeConfigs(path, lines, spec.config.files, &dirty) && waitLoads(loads);
+    }
+    std::this_thread::sleep_until(begin + spec.duration + LEAD);
+
+    kill(getpid(), SIGTERM);
+    daemon.join();
+    removeConfigs(path, spec.config.files);
+    if (!isReloaded) {
+        std::cerr << "Config reload timed out\n";
+        return EXIT_FAILURE;
+    }
+
+    Histogram::Summary loads{ metrics.configLoad.summary() };
+    std::uint64_t reloads{ loads.count - load.count };
+    Histogram::Summary fired{ metrics.tickEvents.summary() };
+    std::cout << "{\"events\":" << spec.config.events
+              << ",\"scheduler\":\"" << spec.scheduler << "\""
+              << ",\"files\":" << spec.config.files
+              << ",\"shards\":" << spec.shards
+              << ",\"duration_s\":" << spec.duration.count()
+              << ",\"load_us\":" << load.sum
+              << ",\"reloads\":" << reloads
+              << ",\"reload_us\":" << (reloads ? (loads.sum - load.sum) / reloads : 0)
+              << ",\"fired\":" << fired.sum
+              << ",\"tick_us\":" << toJson(metrics.tickTime.summary())
+              << ",\"tick_events\":" << toJson(fired)
+              << ",\"lateness_us\":" << toJson(metrics.lateness.summary())
+              << "}" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    BenchSpec spec;
+    std::string outPath{};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:u:U:s:j:R:c:t:g:")) != -1) {
+        try {
+            switch (opt) {
+            case 'n':
+                spec.config.events = std::stoul(optarg);
+                break;
+            case 'r':
+                spec.config.repeatMix = parseMix(optarg);
+                break;
+            case 'u':
+                spec.config.texts = std::stoul(optarg);
+                break;
+            case 'U':
+                spec.config.files = std::stoul(optarg);
+                break;
+            case 's':
+                spec.scheduler = optarg;
+                break;
+            case 'j':
+                spec.shards = std::stoul(optarg);
+                break;
+            case 'R':
+                spec.reloads = std::stoul(optarg);
+                break;
+            case 'c':
+                spec.changed = std::stoul(optarg);
+                break;
+            case 't':
+                spec.duration = std::chrono::seconds(std::stol(optarg));
+                break;
+            case 'g':
+                outPath = optarg;
+                break;
+            default:
+                throw std::invalid_argument(argv[0]);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Usage: " << argv[0] << " [-n events] [-r none,m,h,d,w] [-u texts] [-U files] [-s heap|wheel] [-j shards]"
+                      << " [-R reloads] [-c changed%] [-t seconds] [-g config]\n"
+                      << "  -r sets relative weights of repeat flags, -U splits config into a directory of files,\n"
+                      << "  -g only writes generated config\n";
+            return EXIT_FAILURE;
+        }
+    }
+    spec.config.spread = spec.duration;
+    if (!spec.shards || spec.changed > 100) {
+        std::cerr << "Invalid args: shards must not be zero, changed must be a percent\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!outPath.empty()) {
+        TimePoint start{ std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()) };
+        std::vector<std::string> lines{ ConfigGenerator(spec.config, start).lines() };
+        return writeConfigs(outPath, lines, spec.config.files) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    return run(spec);
+}
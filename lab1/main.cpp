@@ -1,15 +1,126 @@
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
 
 #include "Reminder.h"
 
+// split notifier command line into arguments by whitespace
+std::vector<std::string> splitCommand(const std::string& command) {
+  std::istringstream ss(command);
+  std::vector<std::string> args;
+  std::string arg;
+  while (ss >> arg)
+    args.push_back(arg);
+  return args;
+}
+
+// syslog level by name or number
+int parseLevel(const std::string& name) {
+  static const char* LEVELS[]{ "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug" };
+  for (int i{}; i < 8; ++i)
+    if (name == LEVELS[i])
+      return i;
+
+  int level{ std::stoi(name) };
+  if (level < LOG_EMERG || level > LOG_DEBUG)
+    throw std::out_of_range(name);
+  return level;
+}
+
+// missed repeating events policy by name
+Shard::MissedPolicy parsePolicy(const std::string& name) {
+  if (name == "once")
+    return Shard::MissedPolicy::ONCE;
+  if (name == "all")
+    return Shard::MissedPolicy::ALL;
+  if (name == "skip")
+    return Shard::MissedPolicy::SKIP;
+  throw std::invalid_argument(name);
+}
+
 int main(int argc, char* argv[]) {
-  if (argc != 2) {
-    std::cerr << "Invalid args: specify relative filepath to single config file\n";
+  Reminder::Options options;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:j:J:p:n:o:t:q:b:l:L:S:")) != -1) {
+    try {
+      switch (opt) {
+      case 's':
+        options.scheduler = optarg;
+        break;
+      case 'j':
+        options.shards = std::stoul(optarg);
+        break;
+      case 'J':
+        options.loadThreads = std::stoul(optarg);
+        break;
+      case 'p':
+        options.missed = parsePolicy(optarg);
+        break;
+      case 'n':
+        options.notifier = splitCommand(optarg);
+        break;
+      case 'o':
+        options.sinkPath = optarg;
+        break;
+      case 't':
+        options.dispatchThreads = std::stoul(optarg);
+        break;
+      case 'q':
+        options.dispatchQueue = std::stoul(optarg);
+        break;
+      case 'b':
+        options.batchWindow = std::chrono::milliseconds(std::stoul(optarg));
+        break;
+      case 'l':
+        options.logLevel = parseLevel(optarg);
+        break;
+      case 'L':
+        options.logPath = optarg;
+        break;
+      case 'S':
+        options.simulate = std::chrono::hours(24) * std::stoul(optarg);
+        break;
+      default:
+        throw std::invalid_argument(argv[0]);
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Usage: " << argv[0] << " [-s heap|wheel] [-j shards] [-J load threads] [-p once|all|skip] [-n notifier] [-o sink] [-t threads] [-q queue]"
+                << " [-b batch ms] [-l level] [-L logfile] [-S days] config\n"
+                << "  config is a file or a directory with a config file per user\n"
+                << "  -S replays days of schedule on a simulated clock in foreground and prints a report\n"
+                << "  notifier is a command with " << Dispatcher::TEXT_PLACEHOLDER << " replaced by event text\n"
+                << "  sink is a file or fifo notifications are written to instead of launching notifier\n"
+                << "  batch gathers notifications due within the window into one, identical texts are merged\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (options.notifier.empty() || !options.shards || !options.loadThreads || !options.dispatchThreads || !options.dispatchQueue) {
+    std::cerr << "Invalid args: notifier, shards, load threads, threads and queue must not be empty\n";
     return EXIT_FAILURE;
   }
 
-  Reminder::getInstance().init(argv[1]);  // initialize reminder with config from args
-  Reminder::getInstance().run();  // start reminder running
+  if (argc - optind != 1) {
+    std::cerr << "Invalid args: specify filepath to single config file or directory\n";
+    return EXIT_FAILURE;
+  }
+  options.configPath = argv[optind];
+
+  if (options.simulate.count()) {
+    // simulation doesn't touch the running daemon
+    options.daemonize = false;
+    options.pidPath.clear();
+    options.controlPath.clear();
+    options.snapshotPath.clear();
+  }
+
+  Reminder::getInstance().init(options);  // initialize reminder with config from args
+  if (options.simulate.count())
+    Reminder::getInstance().simulate(); // replay schedule and report
+  else
+    Reminder::getInstance().run();  // start reminder running
 
   return EXIT_SUCCESS;
 }
@@ -12,6 +12,18 @@
 #include <unistd.h>
 
 #include "conn.h"
+#include "ring.h"
+
+// bytes of every direction ring, rounded up to a power of two
+#ifndef SHM_CAPACITY
+#define SHM_CAPACITY (1 << 20)
+#endif
+
+// segment starts with indices of both rings, their data follows
+struct ShmHeader {
+    RingIndices rings[2];   // host to client, client to host
+    alignas(CACHE_LINE) uint64_t capacity;
+};
 
 class ConnSHM : public Conn {
     std::string m_filepath{};
@@ -19,16 +31,22 @@ class ConnSHM : public Conn {
     bool m_isCreate{};
     int m_fd{ -1 };
     void* m_buf{};
-    int m_shift{};
+    size_t m_size{};
+    uint64_t m_capacity{};
+
+    Ring m_in{};
+    Ring m_out{};
 
 public:
-    ConnSHM(pid_t pid, bool isCreate) {
+    ConnSHM(pid_t pid, bool isCreate, size_t capacity = SHM_CAPACITY) {
         m_pid = pid;
         m_filepath = "shm_" + std::to_string(pid);
         m_isCreate = isCreate;
+        for (m_capacity = CACHE_LINE; m_capacity < capacity; m_capacity <<= 1);
     }
     ~ConnSHM() {
-        munmap(m_buf, MAX_SIZE);
+        if (m_buf)
+            munmap(m_buf, m_size);
         close(m_fd);
         if (m_isCreate)
             shm_unlink(m_filepath.c_str());
@@ -41,35 +59,70 @@ public:
             return false;
         }
 
-        if (ftruncate(m_fd, MAX_SIZE) == -1) {
-            syslog(LOG_ERR, "ftruncate(2) call error: %s", strerror(errno));
-            return false;
+        // creator sizes the segment, the peer takes capacity from it
+        if (m_isCreate) {
+            m_size = sizeof(ShmHeader) + 2 * m_capacity;
+            if (ftruncate(m_fd, m_size) == -1) {
+                syslog(LOG_ERR, "ftruncate(2) call error: %s", strerror(errno));
+                return false;
+            }
+        }
+        else {
+            struct stat st;
+            if (fstat(m_fd, &st) == -1) {
+                syslog(LOG_ERR, "fstat(2) call error: %s", strerror(errno));
+                return false;
+            }
+            m_size = st.st_size;
+            if (m_size < sizeof(ShmHeader)) {
+                syslog(LOG_ERR, "shm segment is too small: %zu", m_size);
+                return false;
+            }
         }
 
-        m_buf = mmap(0, MAX_SIZE, PROT_READ | PROT_WRITE, MAP_FILE | MAP_SHARED, m_fd, 0);
+        m_buf = mmap(0, m_size, PROT_READ | PROT_WRITE, MAP_FILE | MAP_SHARED, m_fd, 0);
         if (m_buf == MAP_FAILED) {
             syslog(LOG_ERR, "mmap(2) call error: %s", strerror(errno));
+            m_buf = nullptr;
             close(m_fd);
+            m_fd = -1;
             if (isCreate)
                 shm_unlink(m_filepath.c_str());
             return false;
         }
 
+        ShmHeader* header{ static_cast<ShmHeader*>(m_buf) };
+        if (m_isCreate)
+            header->capacity = m_capacity;
+        else
+            m_capacity = header->capacity;
+        if (!m_capacity || m_capacity & (m_capacity - 1) || m_size != sizeof(ShmHeader) + 2 * m_capacity) {
+            syslog(LOG_ERR, "shm segment has invalid capacity: %lu", static_cast<unsigned long>(m_capacity));
+            return false;
+        }
+
+        char* data{ static_cast<char*>(m_buf) + sizeof(ShmHeader) };
+        int out{ m_isCreate ? 0 : 1 };
+        m_out.attach(&header->rings[out], data + out * m_capacity, m_capacity, true);
+        m_in.attach(&header->rings[1 - out], data + (1 - out) * m_capacity, m_capacity, false);
+        syslog(LOG_INFO, "shm opened with %lu byte rings", static_cast<unsigned long>(m_capacity));
         return true;
     }
 
     bool read(void* buf, size_t size) override {
         if (!m_buf || !buf) return false;
-        if (size + m_shift >= MAX_SIZE) m_shift = 0;
-        memcpy(buf, (char*)m_buf + m_shift, size);
-        m_shift += size;
+        if (!m_in.read(buf, size)) {
+            syslog(LOG_ERR, "shm read timed out");
+            return false;
+        }
         return true;
     }
     bool write(void* buf, size_t size) override {
         if (!m_buf || !buf) return false;
-        if (size + m_shift >= MAX_SIZE) m_shift = 0;
-        memcpy((char*)m_buf + m_shift, buf, size);
-        m_shift += size;
+        if (!m_out.write(buf, size)) {
+            syslog(LOG_ERR, "shm write timed out");
+            return false;
+        }
         return true;
     }
 };
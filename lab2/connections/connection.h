@@ -55,15 +55,16 @@ public:
             return false;
         }
 
-        if (isHost && kill(pidClient, SIGUSR1) != 0) {
-            syslog(LOG_ERR, "kill(2) call error: %s", strerror(errno));
+        // transport is ready before the client is signalled to attach to it
+        if (!conn->open(pidHost, isHost)) {
             sem_close(sem_write);
             sem_close(sem_read);
             delete conn;
             return false;
         }
 
-        if (!conn->open(pidHost, isHost)) {
+        if (isHost && kill(pidClient, SIGUSR1) != 0) {
+            syslog(LOG_ERR, "kill(2) call error: %s", strerror(errno));
             sem_close(sem_write);
             sem_close(sem_read);
             delete conn;
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+
+// single producer single consumer byte ring living in shared memory,
+// head and tail only grow, so position & (capacity - 1) is the offset in data
+struct RingIndices {
+    alignas(CACHE_LINE) std::atomic<uint64_t> head;  // written by producer
+    alignas(CACHE_LINE) std::atomic<uint64_t> tail;  // written by consumer
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring indices must be lock-free to be shared between processes");
+static_assert(sizeof(RingIndices) == 2 * CACHE_LINE, "ring indices must not share cache lines");
+
+class Ring {
+    RingIndices* m_indices{};
+    char* m_data{};
+    uint64_t m_mask{};
+
+    // own index copy and last seen peer index, so the shared lines are touched only when needed
+    uint64_t m_pos{};
+    uint64_t m_peer{};
+
+public:
+    static constexpr std::chrono::seconds TIMEOUT{ 5 };
+
+    // capacity must be a power of two
+    void attach(RingIndices* indices, char* data, uint64_t capacity, bool isProducer) {
+        m_indices = indices;
+        m_data = data;
+        m_mask = capacity - 1;
+        m_pos = isProducer ? indices->head.load(std::memory_order_relaxed) : indices->tail.load(std::memory_order_relaxed);
+        m_peer = isProducer ? indices->tail.load(std::memory_order_acquire) : indices->head.load(std::memory_order_acquire);
+    }
+
+    uint64_t capacity() const {
+        return m_mask + 1;
+    }
+
+    // copies size bytes in, waits for consumer while ring is full
+    bool write(const void* buf, size_t size) {
+        const char* src{ static_cast<const char*>(buf) };
+        auto deadline = std::chrono::steady_clock::now() + TIMEOUT;
+        while (size) {
+            uint64_t free{ capacity() - (m_pos - m_peer) };
+            if (!free) {
+                m_peer = m_indices->tail.load(std::memory_order_acquire);
+                if (m_peer + capacity() == m_pos && !wait(deadline))
+                    return false;
+                continue;
+            }
+
+            size_t chunk{ static_cast<size_t>(std::min<uint64_t>(free, size)) };
+            copyIn(m_pos, src, chunk);
+            m_pos += chunk;
+            m_indices->head.store(m_pos, std::memory_order_release);
+            src += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+    // copies size bytes out, waits for producer while ring is empty
+    bool read(void* buf, size_t size) {
+        char* dst{ static_cast<char*>(buf) };
+        auto deadline = std::chrono::steady_clock::now() + TIMEOUT;
+        while (size) {
+            uint64_t used{ m_peer - m_pos };
+            if (!used) {
+                m_peer = m_indices->head.load(std::memory_order_acquire);
+                if (m_peer == m_pos && !wait(deadline))
+                    return false;
+                continue;
+            }
+
+            size_t chunk{ static_cast<size_t>(std::min<uint64_t>(used, size)) };
+            copyOut(m_pos, dst, chunk);
+            m_pos += chunk;
+            m_indices->tail.store(m_pos, std::memory_order_release);
+            dst += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+private:
+    // chunk may wrap around the end of data
+    void copyIn(uint64_t pos, const char* src, size_t size) {
+        size_t offset{ static_cast<size_t>(pos & m_mask) };
+        size_t first{ std::min<size_t>(size, capacity() - offset) };
+        memcpy(m_data + offset, src, first);
+        memcpy(m_data, src + first, size - first);
+    }
+
+    void copyOut(uint64_t pos, char* dst, size_t size) const {
+        size_t offset{ static_cast<size_t>(pos & m_mask) };
+        size_t first{ std::min<size_t>(size, capacity() - offset) };
+        memcpy(dst, m_data + offset, first);
+        memcpy(dst + first, m_data, size - first);
+    }
+
+    bool wait(std::chrono::steady_clock::time_point deadline) const {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        sched_yield();
+        return true;
+    }
+};